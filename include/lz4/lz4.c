@@ -0,0 +1,292 @@
+/*
+ * LZ4 block compression, see lz4.h.
+ *
+ * The compressor is the greedy single-pass hash chain of the reference
+ * implementation: one 4096-entry table of positions keyed by the next 4 bytes,
+ * a search step that grows on incompressible input, and matches extended 8
+ * bytes at a time. It respects the format's end-of-block rules (the last 5
+ * bytes are literals and no match starts in the last 12 bytes), so any LZ4
+ * decoder accepts its blocks.
+ */
+#include "lz4.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define MINMATCH 4
+#define LASTLITERALS 5
+#define MFLIMIT 12
+#define MIN_LENGTH (MFLIMIT + 1)
+#define MAX_DISTANCE 65535
+#define ML_BITS 4
+#define ML_MASK ((1U << ML_BITS) - 1)
+#define RUN_MASK ((1U << (8 - ML_BITS)) - 1)
+#define HASH_LOG 12
+#define SKIP_TRIGGER 6
+#define WILDCOPY_LENGTH 8
+
+static uint32_t Read32(const void *p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static uint64_t Read64(const void *p) {
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static void Write16(void *p, uint16_t value) {
+  unsigned char *out = (unsigned char *)p;
+  out[0] = (unsigned char)value;
+  out[1] = (unsigned char)(value >> 8);
+}
+
+/* hashes the 5 bytes at p, fewer collisions than 4 on text-like data */
+static uint32_t Hash(const unsigned char *p) {
+  return (uint32_t)(((Read64(p) << 24) * 889523592379ULL) >> (64 - HASH_LOG));
+}
+
+/* number of equal bytes at in and match, in stops at inLimit */
+static unsigned Count(const unsigned char *in, const unsigned char *match,
+                      const unsigned char *inLimit) {
+  const unsigned char *start = in;
+  while (in + 8 <= inLimit) {
+    uint64_t diff = Read64(in) ^ Read64(match);
+    if (diff)
+      return (unsigned)(in - start) + (unsigned)(__builtin_ctzll(diff) >> 3);
+    in += 8;
+    match += 8;
+  }
+  while (in < inLimit && *in == *match) {
+    in++;
+    match++;
+  }
+  return (unsigned)(in - start);
+}
+
+static unsigned char *WriteLength(unsigned char *op, unsigned length) {
+  while (length >= 255) {
+    *op++ = 255;
+    length -= 255;
+  }
+  *op++ = (unsigned char)length;
+  return op;
+}
+
+int LZ4_compressBound(int inputSize) { return LZ4_COMPRESSBOUND(inputSize); }
+
+int LZ4_compress_default(const char *source, char *dest, int srcSize,
+                         int dstCapacity) {
+  const unsigned char *const src = (const unsigned char *)source;
+  const unsigned char *ip = src;
+  const unsigned char *anchor = src;
+  const unsigned char *const iend = src + srcSize;
+  unsigned char *op = (unsigned char *)dest;
+  unsigned char *const oend = op + dstCapacity;
+
+  if (srcSize < 0 || (unsigned)srcSize > LZ4_MAX_INPUT_SIZE || dstCapacity < 0)
+    return 0;
+
+  if (srcSize >= MIN_LENGTH) {
+    const unsigned char *const mflimitPlusOne = iend - MFLIMIT + 1;
+    const unsigned char *const matchLimit = iend - LASTLITERALS;
+    uint32_t table[1 << HASH_LOG];
+    uint32_t forwardHash;
+    memset(table, 0, sizeof(table));
+
+    table[Hash(ip)] = 0;
+    forwardHash = Hash(++ip);
+
+    for (;;) {
+      const unsigned char *match;
+      unsigned char *token;
+      unsigned literalLength;
+
+      /* find a match, stepping faster through data that does not compress */
+      {
+        const unsigned char *forwardIp = ip;
+        unsigned step = 1;
+        unsigned searchMatchNb = 1U << SKIP_TRIGGER;
+        do {
+          uint32_t hash = forwardHash;
+          ip = forwardIp;
+          forwardIp += step;
+          step = searchMatchNb++ >> SKIP_TRIGGER;
+          if (forwardIp > mflimitPlusOne)
+            goto lastLiterals;
+          match = src + table[hash];
+          forwardHash = Hash(forwardIp);
+          table[hash] = (uint32_t)(ip - src);
+        } while (match + MAX_DISTANCE < ip || Read32(match) != Read32(ip));
+      }
+
+      /* extend the match backwards over the pending literals */
+      while (ip > anchor && match > src && ip[-1] == match[-1]) {
+        ip--;
+        match--;
+      }
+
+      literalLength = (unsigned)(ip - anchor);
+      token = op++;
+      if (op + literalLength + literalLength / 255 + 2 + 1 + LASTLITERALS >
+          oend)
+        return 0;
+      if (literalLength >= RUN_MASK) {
+        *token = (unsigned char)(RUN_MASK << ML_BITS);
+        op = WriteLength(op, literalLength - RUN_MASK);
+      } else {
+        *token = (unsigned char)(literalLength << ML_BITS);
+      }
+      memcpy(op, anchor, literalLength);
+      op += literalLength;
+
+      for (;;) {
+        unsigned matchCode;
+        Write16(op, (uint16_t)(ip - match));
+        op += 2;
+
+        matchCode = Count(ip + MINMATCH, match + MINMATCH, matchLimit);
+        ip += MINMATCH + matchCode;
+        if (op + matchCode / 255 + 1 + LASTLITERALS > oend)
+          return 0;
+        if (matchCode >= ML_MASK) {
+          *token += ML_MASK;
+          op = WriteLength(op, matchCode - ML_MASK);
+        } else {
+          *token += (unsigned char)matchCode;
+        }
+        anchor = ip;
+
+        if (ip >= mflimitPlusOne)
+          goto lastLiterals;
+
+        table[Hash(ip - 2)] = (uint32_t)(ip - 2 - src);
+
+        /* a match right at the end of the last one needs no literals */
+        {
+          uint32_t hash = Hash(ip);
+          match = src + table[hash];
+          table[hash] = (uint32_t)(ip - src);
+        }
+        if (match + MAX_DISTANCE < ip || Read32(match) != Read32(ip))
+          break;
+        token = op++;
+        *token = 0;
+      }
+
+      forwardHash = Hash(++ip);
+    }
+  }
+
+lastLiterals:
+  {
+    unsigned lastRun = (unsigned)(iend - anchor);
+    if (op + lastRun + 1 + (lastRun + 255 - RUN_MASK) / 255 > oend)
+      return 0;
+    if (lastRun >= RUN_MASK) {
+      *op++ = (unsigned char)(RUN_MASK << ML_BITS);
+      op = WriteLength(op, lastRun - RUN_MASK);
+    } else {
+      *op++ = (unsigned char)(lastRun << ML_BITS);
+    }
+    memcpy(op, anchor, lastRun);
+    op += lastRun;
+  }
+  return (int)(op - (unsigned char *)dest);
+}
+
+/* reads a length extension, returns 0 on a truncated block */
+static int ReadLength(const unsigned char **ip, const unsigned char *iend,
+                      size_t *length) {
+  unsigned char byte;
+  do {
+    if (*ip >= iend)
+      return 0;
+    byte = *(*ip)++;
+    *length += byte;
+  } while (byte == 255);
+  return 1;
+}
+
+int LZ4_decompress_safe(const char *source, char *dest, int compressedSize,
+                        int dstCapacity) {
+  const unsigned char *ip = (const unsigned char *)source;
+  const unsigned char *const iend = ip + compressedSize;
+  unsigned char *op = (unsigned char *)dest;
+  unsigned char *const ostart = op;
+  unsigned char *const oend = op + dstCapacity;
+
+  if (source == NULL || compressedSize <= 0 || dstCapacity < 0)
+    return -1;
+
+  for (;;) {
+    unsigned token;
+    size_t length, offset;
+    const unsigned char *match;
+
+    if (ip >= iend)
+      return -1;
+    token = *ip++;
+
+    length = token >> ML_BITS;
+    if (length == RUN_MASK && !ReadLength(&ip, iend, &length))
+      return -1;
+    if (length > (size_t)(iend - ip) || length > (size_t)(oend - op))
+      return -1;
+    if (length <= 16 && iend - ip >= 16 && oend - op >= 16)
+      memcpy(op, ip, 16); /* a fixed size copy is cheaper than an exact one */
+    else
+      memcpy(op, ip, length);
+    op += length;
+    ip += length;
+
+    /* the last sequence only carries literals */
+    if (ip == iend)
+      break;
+
+    if (iend - ip < 2)
+      return -1;
+    offset = (size_t)ip[0] | (size_t)ip[1] << 8;
+    ip += 2;
+    if (offset == 0 || offset > (size_t)(op - ostart))
+      return -1;
+    match = op - offset;
+
+    length = token & ML_MASK;
+    if (length == ML_MASK && !ReadLength(&ip, iend, &length))
+      return -1;
+    length += MINMATCH;
+    if (length > (size_t)(oend - op))
+      return -1;
+
+    if (offset >= 2 * WILDCOPY_LENGTH &&
+        (size_t)(oend - op) >= length + 2 * WILDCOPY_LENGTH) {
+      /* whole words, the source is never overwritten before it is read */
+      unsigned char *const end = op + length;
+      do {
+        memcpy(op, match, 2 * WILDCOPY_LENGTH);
+        op += 2 * WILDCOPY_LENGTH;
+        match += 2 * WILDCOPY_LENGTH;
+      } while (op < end);
+      op = end;
+    } else if (offset >= WILDCOPY_LENGTH &&
+               (size_t)(oend - op) >= length + WILDCOPY_LENGTH) {
+      unsigned char *const end = op + length;
+      do {
+        memcpy(op, match, WILDCOPY_LENGTH);
+        op += WILDCOPY_LENGTH;
+        match += WILDCOPY_LENGTH;
+      } while (op < end);
+      op = end;
+    } else {
+      /* overlapping matches repeat the last offset bytes */
+      size_t i;
+      for (i = 0; i < length; i++)
+        op[i] = match[i];
+      op += length;
+    }
+  }
+  return (int)(op - ostart);
+}
@@ -0,0 +1,47 @@
+/*
+ * LZ4 block compression.
+ *
+ * Implements the LZ4 block format
+ * (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md) behind the
+ * block API of the reference library's lz4.h: the functions below have the
+ * same names, signatures and return conventions, so blocks are interchangeable
+ * with liblz4 and lz4.h/lz4.c from the reference library can replace these
+ * files unchanged.
+ */
+#ifndef LZ4_H_2983827168210
+#define LZ4_H_2983827168210
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define LZ4_MAX_INPUT_SIZE 0x7E000000 /* 2 113 929 216 bytes */
+#define LZ4_COMPRESSBOUND(isize)                                               \
+  ((unsigned)(isize) > (unsigned)LZ4_MAX_INPUT_SIZE                            \
+       ? 0                                                                     \
+       : (isize) + ((isize) / 255) + 16)
+
+/*
+ * Compresses srcSize bytes of src into dst. Returns the number of bytes
+ * written, or 0 if dstCapacity is too small or srcSize is out of range.
+ * Compression always succeeds if dstCapacity >= LZ4_compressBound(srcSize).
+ */
+int LZ4_compress_default(const char *src, char *dst, int srcSize,
+                         int dstCapacity);
+
+/*
+ * Decompresses the block of compressedSize bytes at src into dst. Returns the
+ * number of bytes written, or a negative value if the block is malformed or
+ * would not fit into dstCapacity. Never reads or writes outside the buffers.
+ */
+int LZ4_decompress_safe(const char *src, char *dst, int compressedSize,
+                        int dstCapacity);
+
+/* worst case compressed size of inputSize bytes, 0 if out of range */
+int LZ4_compressBound(int inputSize);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
@@ -32,6 +32,8 @@ public:
 
 private:
   void DealCards(CommunityInfo &newCommunity, vector<PlayerInfo> &newPlayers);
+  void DealBoardCard(CommunityInfo &newCommunity,
+                     vector<PlayerInfo> &newPlayers, ulong card);
 };
 } // namespace poker
 
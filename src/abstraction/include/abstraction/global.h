@@ -52,9 +52,6 @@ public:
   inline static const int nofRiverBuckets = 200;
   inline static const int nofTurnBuckets = 200;
   inline static const int nofFlopBuckets = 200;
-  // 100k or even 1 million shouldn't take too much time compared to the rest of
-  // the information abstraction
-  inline static const int nofMCSimsPerPreflopHand = 1000000;
   // for the river, determines the river histogram size (in theory could be up
   // to 169 but will be very slow) default 8
   inline static const int nofOpponentClusters = 16;
@@ -66,13 +63,15 @@ public:
   // is very fast
   inline static const int preflopHistogramSize = 50;
 
+  // evaluate 7-card hands from the memory mapped HandRankTable7.bin (267MB)
+  // instead of the small flush and rank tables
+  inline static const bool flatHandEvaluator = false;
+
   // dont change
   static HandIndexer indexer_2;
   static HandIndexer indexer_2_3;
   static HandIndexer indexer_2_4;
   static HandIndexer indexer_2_5;
-  static HandIndexer indexer_2_3_1;
-  static HandIndexer indexer_2_3_1_1;
   static HandIndexer indexer_2_5_2;
 
   static shared_ptr<Evaluator> handEvaluator;
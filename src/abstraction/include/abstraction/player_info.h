@@ -3,6 +3,7 @@
 
 #include "enums/action.h"
 #include "game/hand.h"
+#include "tables/hand_indexer.h"
 
 #include <iostream>
 #include <tuple>
@@ -19,9 +20,14 @@ public:
   int reward;
   tuple<ulong, ulong> cards;
   Action lastAction;
+  // hole cards and the board dealt so far, indexed one card at a time
+  StreetIndexer street;
 
   PlayerInfo();
 
+  void DealHoleCards(ulong card1, ulong card2);
+  void DealBoardCard(ulong card);
+
   ulong GetCardBitmask() const;
 
   bool IsAlive() const;
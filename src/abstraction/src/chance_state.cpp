@@ -56,26 +56,36 @@ void ChanceState::DealCards(CommunityInfo &newCommunity,
   case BettingRound::Preflop:
     Global::deck.Shuffle();
     for (auto i = 0; i < Global::nofPlayers; ++i) {
-      newPlayers[i].cards = {Global::deck.Peek(i * 2),
-                             Global::deck.Peek(i * 2 + 1)};
+      newPlayers[i].DealHoleCards(Global::deck.Peek(i * 2),
+                                  Global::deck.Peek(i * 2 + 1));
     }
     break;
   case BettingRound::Flop:
-    newCommunity.cards.push_back(Global::deck.Peek(Global::nofPlayers * 2 + 0));
-    newCommunity.cards.push_back(Global::deck.Peek(Global::nofPlayers * 2 + 1));
-    newCommunity.cards.push_back(Global::deck.Peek(Global::nofPlayers * 2 + 2));
+    for (auto i = 0; i < 3; ++i)
+      DealBoardCard(newCommunity, newPlayers,
+                    Global::deck.Peek(Global::nofPlayers * 2 + i));
     break;
   case BettingRound::Turn:
-    newCommunity.cards.push_back(Global::deck.Peek(Global::nofPlayers * 2 + 3));
+    DealBoardCard(newCommunity, newPlayers,
+                  Global::deck.Peek(Global::nofPlayers * 2 + 3));
     break;
   case BettingRound::River:
-    newCommunity.cards.push_back(Global::deck.Peek(Global::nofPlayers * 2 + 4));
+    DealBoardCard(newCommunity, newPlayers,
+                  Global::deck.Peek(Global::nofPlayers * 2 + 4));
     break;
   default:
     throw invalid_argument("Unknown betting round");
   }
 }
 
+// every player's street index follows the board as it is dealt
+void ChanceState::DealBoardCard(CommunityInfo &newCommunity,
+                                vector<PlayerInfo> &newPlayers, ulong card) {
+  newCommunity.cards.push_back(card);
+  for (auto &player : newPlayers)
+    player.DealBoardCard(card);
+}
+
 /// <summary>
 /// Note: The single child was already randomly created
 /// </summary>
@@ -114,9 +124,9 @@ vector<shared_ptr<PlayState>> ChanceState::GetFirstActionStates() {
 
   for (auto i = 0; i < Global::RANKS * Global::RANKS; ++i) {
     auto newPlayers = vector<PlayerInfo>(players);
-    newPlayers[2 % Global::nofPlayers].cards = {
+    newPlayers[2 % Global::nofPlayers].DealHoleCards(
         startingHands[i].cards[0].Bitmask(),
-        startingHands[i].cards[1].Bitmask()};
+        startingHands[i].cards[1].Bitmask());
     newCommunity.cards = vector<ulong>();
     newCommunity.lastPlayer = lastToMoveTemp;
     newCommunity.minRaise = minRaiseTemp;
@@ -1,4 +1,5 @@
 #include "abstraction/global.h"
+#include "tables/flat_evaluator.h"
 
 namespace poker {
 // ratios must be sorted in ascending order
@@ -50,11 +51,10 @@ HandIndexer Global::indexer_2;
 HandIndexer Global::indexer_2_3;
 HandIndexer Global::indexer_2_4;
 HandIndexer Global::indexer_2_5;
-HandIndexer Global::indexer_2_3_1;
-HandIndexer Global::indexer_2_3_1_1;
 HandIndexer Global::indexer_2_5_2;
 
-shared_ptr<Evaluator> Global::handEvaluator = make_shared<Evaluator>();
+shared_ptr<Evaluator> Global::handEvaluator =
+    flatHandEvaluator ? make_shared<FlatEvaluator>() : make_shared<Evaluator>();
 
 NodeMap Global::nodeMap = {};
 
@@ -83,28 +83,20 @@ void PlayState::GenerateUniqueStringIdentifier() {
   }
   string historyString = historyStringStream.str();
 
-  auto cards = vector<int>{
-      Card::GetIndexFromBitmask(get<0>(players[community.playerToMove].cards)),
-      Card::GetIndexFromBitmask(get<1>(players[community.playerToMove].cards))};
-  for (auto i = 0UL; i < community.cards.size(); ++i) {
-    cards.push_back(Card::GetIndexFromBitmask(community.cards[i]));
-  }
-
+  // the player's street index was carried along as the board was dealt
+  auto &street = players[community.playerToMove].street;
   string cardString = "";
   if (community.cards.size() == 0) {
-    long index = Global::indexer_2.IndexLastRound(cards);
+    long index = street.Index(Global::indexer_2);
     cardString += "P" + to_string(index);
   } else if (community.cards.size() == 3) {
-    long index =
-        EMDTable::flopIndices[Global::indexer_2_3.IndexLastRound(cards)];
+    long index = EMDTable::flopIndices[street.Index(Global::indexer_2_3)];
     cardString += "F" + to_string(index);
   } else if (community.cards.size() == 4) {
-    long index =
-        EMDTable::turnIndices[Global::indexer_2_4.IndexLastRound(cards)];
+    long index = EMDTable::turnIndices[street.Index(Global::indexer_2_4)];
     cardString += "T" + to_string(index);
   } else {
-    long index =
-        OCHSTable::riverIndices[Global::indexer_2_5.IndexLastRound(cards)];
+    long index = OCHSTable::riverIndices[street.Index(Global::indexer_2_5)];
     cardString += "R" + to_string(index);
   }
   infosetString = historyString + cardString;
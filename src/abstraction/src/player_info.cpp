@@ -6,6 +6,16 @@ namespace poker {
 PlayerInfo::PlayerInfo()
     : stack{0}, bet{0}, reward{0}, cards(), lastAction{Action::None} {}
 
+void PlayerInfo::DealHoleCards(ulong card1, ulong card2) {
+  cards = {card1, card2};
+  street = StreetIndexer(Card::GetIndexFromBitmask(card1),
+                         Card::GetIndexFromBitmask(card2));
+}
+
+void PlayerInfo::DealBoardCard(ulong card) {
+  street.Deal(Card::GetIndexFromBitmask(card));
+}
+
 ulong PlayerInfo::GetCardBitmask() const {
   return get<0>(cards) | get<1>(cards);
 }
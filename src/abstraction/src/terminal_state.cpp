@@ -31,13 +31,18 @@ void TerminalState::CreateRewards() {
   } else {
     // at least 2 players are in
     auto handValues = vector<int>(Global::nofPlayers, -1);
+    array<ulong, Global::nofPlayers> holeCards;
+    array<int, Global::nofPlayers> aliveValues;
+    auto nofAlive = 0;
     for (auto i = 0; i < Global::nofPlayers; ++i) {
-      if (!players[i].IsAlive())
-        continue;
-
-      ulong cardsBitmask =
-          players[i].GetCardBitmask() | community.GetCardBitmask();
-      handValues[i] = evaluator->Evaluate(cardsBitmask);
+      if (players[i].IsAlive())
+        holeCards[nofAlive++] = players[i].GetCardBitmask();
+    }
+    evaluator->EvaluateBatch(community.GetCardBitmask(),
+                             span(holeCards.data(), nofAlive), aliveValues);
+    for (auto i = 0, alive = 0; i < Global::nofPlayers; ++i) {
+      if (players[i].IsAlive())
+        handValues[i] = aliveValues[alive++];
     }
     auto playersWithBestHand = vector<int>();
     auto maxHandValue = *max_element(handValues.begin(), handValues.end());
@@ -0,0 +1,70 @@
+#ifndef __CLASS_CHECKPOINT_H__
+#define __CLASS_CHECKPOINT_H__
+
+#include "abstraction/global.h"
+#include "abstraction/infoset.h"
+#include "utils/compression.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace poker {
+/// <summary>
+/// Trainer state needed to continue a run exactly where it stopped
+/// </summary>
+struct TrainingProgress {
+  long iterations = 0;
+  vector<long> threadIterations; // per-thread t, drives pruning and LCFR
+  long strategyIntervalCountdown = 0;
+  long discountIntervalCountdown = 0;
+  long saveToDiskIntervalCountdown = 0;
+  long testGamesIntervalCountdown = 0;
+  string randomState;
+  uint32_t abstractionFingerprint = 0;
+};
+
+/// <summary>
+/// Compressed on-disk format of the node map.
+///
+/// Every submap of the node map is written as one independent block: keys are
+/// sorted and prefix-delta encoded, regrets and action counters are zigzag
+/// varints and the block is then LZ4 compressed. Blocks are encoded and decoded
+/// in parallel and the training progress is stored in front of them.
+/// </summary>
+class Checkpoint {
+public:
+  static void Save(NodeMap &nodeMap, const TrainingProgress &progress,
+                   const string &filename);
+  static void Load(NodeMap &nodeMap, TrainingProgress &progress,
+                   const string &filename);
+  static bool IsCheckpointFile(const string &filename);
+
+private:
+  inline static const string MAGIC = "MCCFRCKP";
+  static const uint32_t VERSION = 1;
+
+  struct BlockHeader {
+    uint64_t rawSize;
+    uint64_t compressedSize;
+    uint64_t entries;
+    uint32_t checksum;
+  };
+
+  static string EncodeBlock(vector<const pair<const string, Infoset> *> &entries);
+  static void DecodeBlock(string_view raw, uint64_t entries,
+                          NodeMap &nodeMap);
+
+  static string EncodeProgress(const TrainingProgress &progress);
+  static TrainingProgress DecodeProgress(string_view raw);
+
+  static uint64_t EncodeRegret(int value);
+  static int DecodeRegret(uint64_t value);
+};
+} // namespace poker
+
+#endif
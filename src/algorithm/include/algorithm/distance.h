@@ -0,0 +1,118 @@
+#ifndef __CLASS_DISTANCE_H__
+#define __CLASS_DISTANCE_H__
+
+#include "utils/matrix.h"
+
+#include <cmath>
+#include <cstddef>
+#include <string>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace poker {
+namespace distance {
+#ifdef __AVX2__
+inline float HorizontalSum(__m256 v) {
+  __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  sum = _mm_hadd_ps(sum, sum);
+  sum = _mm_hadd_ps(sum, sum);
+  return _mm_cvtss_f32(sum);
+}
+#endif
+
+// rows are aligned and length is a whole number of cache lines, see Matrix
+inline float L1(const float *a, const float *b, size_t length) {
+#ifdef __AVX2__
+  const __m256 sign = _mm256_set1_ps(-0.0f);
+  __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+  for (size_t i = 0; i < length; i += 16) {
+    sum0 = _mm256_add_ps(
+        sum0, _mm256_andnot_ps(sign, _mm256_sub_ps(_mm256_load_ps(a + i),
+                                                   _mm256_load_ps(b + i))));
+    sum1 = _mm256_add_ps(
+        sum1, _mm256_andnot_ps(sign, _mm256_sub_ps(_mm256_load_ps(a + i + 8),
+                                                   _mm256_load_ps(b + i + 8))));
+  }
+  return HorizontalSum(_mm256_add_ps(sum0, sum1));
+#else
+  float sum = 0.0f;
+  for (size_t i = 0; i < length; i++)
+    sum += abs(a[i] - b[i]);
+  return sum;
+#endif
+}
+
+inline float SquaredL2(const float *a, const float *b, size_t length) {
+#ifdef __AVX2__
+  __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+  for (size_t i = 0; i < length; i += 16) {
+    __m256 diff0 = _mm256_sub_ps(_mm256_load_ps(a + i), _mm256_load_ps(b + i));
+    __m256 diff1 =
+        _mm256_sub_ps(_mm256_load_ps(a + i + 8), _mm256_load_ps(b + i + 8));
+    sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(diff0, diff0));
+    sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(diff1, diff1));
+  }
+  return HorizontalSum(_mm256_add_ps(sum0, sum1));
+#else
+  float sum = 0.0f;
+  for (size_t i = 0; i < length; i++)
+    sum += (a[i] - b[i]) * (a[i] - b[i]);
+  return sum;
+#endif
+}
+} // namespace distance
+
+/// <summary>
+/// Distance metrics of k-means, passed as template parameters so the kernels
+/// are inlined into the clustering loops.
+///
+/// Prepare turns the rows into the representation the metric is computed on,
+/// PrepareRow a single row of cols entries, centers are means of prepared
+/// rows. Distance reads rows up to the padded
+/// stride of the matrix, the padding is zero in both rows so adds nothing.
+/// </summary>
+struct L2Distance {
+  inline static const string NAME = "L2";
+
+  static void Prepare(utils::Matrix<float> & /*data*/) {}
+  static void PrepareRow(float * /*row*/, size_t /*cols*/) {}
+
+  static float Distance(const float *a, const float *b, size_t stride) {
+    return sqrt(distance::SquaredL2(a, b, stride));
+  }
+};
+
+// the earth mover's distance of histograms over equally spaced bins is the L1
+// distance of their cumulative histograms, and the mean of cumulative
+// histograms is the cumulative histogram of their mean
+struct EMDDistance {
+  inline static const string NAME = "EMD";
+
+  static void Prepare(utils::Matrix<float> &data) {
+    for (auto row = 0UL; row < data.Rows(); row++)
+      PrepareRow(data[row], data.Cols());
+  }
+
+  static void PrepareRow(float *row, size_t cols) {
+    for (auto i = 1UL; i < cols; i++)
+      row[i] += row[i - 1];
+  }
+
+  static float Distance(const float *a, const float *b, size_t stride) {
+    return distance::L1(a, b, stride);
+  }
+};
+
+// distances of one row to all centers
+template <typename Metric>
+inline void DistancesToCenters(const float *row,
+                               const utils::Matrix<float> &centers,
+                               float *distances) {
+  for (auto c = 0UL; c < centers.Rows(); c++)
+    distances[c] = Metric::Distance(row, centers[c], centers.Stride());
+}
+} // namespace poker
+#endif
@@ -2,14 +2,21 @@
 #define __CLASS_KMEANS_H__
 
 #include "abstraction/global.h"
+#include "algorithm/distance.h"
+#include "utils/chunked_matrix.h"
+#include "utils/compression.h"
+#include "utils/matrix.h"
 #include "utils/random.h"
 #include "utils/utils.h"
 
+#include <algorithm>
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/serialization/vector.hpp>
+#include <chrono>
 #include <float.h>
 #include <indicators/block_progress_bar.hpp>
 #include <indicators/cursor_control.hpp>
+#include <numeric>
 #include <oneapi/tbb.h>
 #include <unordered_set>
 #include <vector>
@@ -17,6 +24,55 @@
 using namespace std;
 
 namespace poker {
+// sizes of the mini-batch mode, for data too large for full iterations
+struct MiniBatchOptions {
+  int batchSize = 1 << 14;
+  // rows sampled from the data once, the batches are drawn from these
+  long sampleSize = 1 << 22;
+  // rows never used in a batch, convergence is measured on these
+  long holdOutSize = 1 << 16;
+  int evaluationInterval = 20;
+  int maxIterations = 5000;
+};
+
+/// <summary>
+/// Snapshot of a clustering in progress, saved periodically so an interrupted
+/// clustering continues from it instead of starting over
+/// </summary>
+struct KmeansCheckpoint {
+  // the data, k and metric the snapshot was taken of
+  uint32_t fingerprint = 0;
+
+  // full iterations: runs completed, assignments of the current run and of
+  // the best run so far
+  int run = 0;
+  vector<int> assignments;
+  vector<int> recordAssignments;
+  float recordDistance = FLT_MAX;
+
+  // mini-batch: batches completed, the centers and the rows assigned to each
+  int iteration = 0;
+  bool trained = false;
+  utils::Matrix<float> centers;
+  vector<long> counts;
+  float bestDistance = FLT_MAX;
+  int evaluationsWithoutImprovement = 0;
+
+  template <class Archive> void serialize(Archive &ar, const unsigned int) {
+    ar &fingerprint;
+    ar &run;
+    ar &assignments;
+    ar &recordAssignments;
+    ar &recordDistance;
+    ar &iteration;
+    ar &trained;
+    ar &centers;
+    ar &counts;
+    ar &bestDistance;
+    ar &evaluationsWithoutImprovement;
+  }
+};
+
 /// <summary>
 /// Cluster the elements in the input array into k distinct buckets and return
 /// them
@@ -24,57 +80,123 @@ namespace poker {
 class Kmeans {
 public:
   Kmeans() {}
+  // snapshots the clustering to checkpointFilename every few minutes and
+  // resumes from it if it was taken of the same data
+  explicit Kmeans(const string &checkpointFilename)
+      : checkpointFilename{checkpointFilename} {}
 
   /// <summary>
   /// Returns an array where the element at index i contains the cluster entry
-  /// associated with the entry
+  /// associated with the entry, EMD turns the rows of data into cumulative
+  /// histograms in place
   /// </summary>
   /// <param name="data"></param>
   /// <param name="k"></param>
   /// <returns></returns>
-  vector<int> Cluster(function<float(vector<vector<float>> &,
-                                     vector<vector<float>> &, int, int)>
-                          distanceFunc,
-                      vector<vector<float>> &data, int k, int nofRuns,
-                      vector<int> &_bestCenters);
-  vector<int> ClusterEMD(vector<vector<float>> &data, int k, int nofRuns,
+  vector<int> ClusterEMD(utils::Matrix<float> &data, int k, int nofRuns,
                          vector<int> &_bestCenters);
-  vector<int> ClusterL2(vector<vector<float>> &data, int k, int nofRuns,
+  vector<int> ClusterL2(utils::Matrix<float> &data, int k, int nofRuns,
                         vector<int> &_bestCenters);
 
+  /// <summary>
+  /// Mini-batch k-means: the centers are seeded and trained on a sample of
+  /// the rows and every row is assigned to its nearest center in one final
+  /// pass, so only one chunk of the data is held in memory at a time
+  /// </summary>
+  vector<int> ClusterEMD(const utils::ChunkedMatrix &data, int k,
+                         const MiniBatchOptions &options = MiniBatchOptions());
+  vector<int> ClusterL2(const utils::ChunkedMatrix &data, int k,
+                        const MiniBatchOptions &options = MiniBatchOptions());
+
 private:
-  // percentage delta compared to the previous iteration
-  inline static const float stopClusterImprovementThreshold = 1e-5;
-
-  vector<vector<float>> CalculateNewCenters(vector<vector<float>> &data,
-                                            vector<int> &bestCenters, int k);
-
-  void
-  CalculateClusterDistances(function<float(vector<vector<float>> &,
-                                           vector<vector<float>> &, int, int)>
-                                distanceFunc,
-                            vector<vector<float>> &distances,
-                            vector<vector<float>> &clusterCenters);
-
-  vector<vector<float>>
-  FindStartingCenters(function<float(vector<vector<float>> &,
-                                     vector<vector<float>> &, int, int)>
-                          distanceFunc,
-                      vector<vector<float>> &data, int k);
-
-  static vector<vector<float>> GetRandomSubset(vector<vector<float>> &data,
-                                               int nofSamples);
+  string checkpointFilename;
+  chrono::steady_clock::time_point lastCheckpoint =
+      chrono::steady_clock::now();
+  inline static const chrono::seconds checkpointInterval =
+      chrono::minutes(10);
+
+  // fraction of elements changing cluster in an iteration
+  inline static const float stopClusterReassignedThreshold = 1e-5;
+  // held-out distance improvement below which an evaluation does not count,
+  // mini-batch stops after miniBatchPatience of these in a row
+  inline static const float stopMiniBatchImprovementThreshold = 1e-3;
+  inline static const int miniBatchPatience = 3;
+  // oversampling rounds of k-means|| and iterations to reduce their centers
+  inline static const int seedingRounds = 5;
+  inline static const int maxWeightedIterations = 100;
+
+  template <typename Metric>
+  static uint32_t Fingerprint(uint32_t data, long rows, size_t cols, int k);
+  static uint32_t Checksum(utils::Matrix<float> &data);
+  // false if there is no snapshot of the data with this fingerprint
+  bool LoadCheckpoint(KmeansCheckpoint &checkpoint);
+  bool CheckpointDue() const;
+  void SaveCheckpoint(const KmeansCheckpoint &checkpoint);
+
+  // Metric is one of the kernels in algorithm/distance.h
+  template <typename Metric>
+  vector<int> Cluster(utils::Matrix<float> &data, int k, int nofRuns,
+                      vector<int> &_bestCenters);
+  template <typename Metric>
+  vector<int> ClusterMiniBatch(const utils::ChunkedMatrix &data, int k,
+                               const MiniBatchOptions &options);
+
+  // adds every element to the sum of its cluster, the sums are kept per
+  // thread in double precision and reduced by ReduceClusterSums
+  static void SumClusters(utils::Matrix<float> &data, vector<int> &bestCenters,
+                          vector<utils::Matrix<double>> &threadSums,
+                          vector<vector<long>> &threadSizes);
+  // adds the thread sums to sums and clears them
+  static void ReduceClusterSums(vector<utils::Matrix<double>> &threadSums,
+                                vector<vector<long>> &threadSizes,
+                                utils::Matrix<double> &sums,
+                                vector<long> &sizes);
+  // means of the clusters, zero for empty clusters
+  static utils::Matrix<float> CentersFromSums(utils::Matrix<double> &sums,
+                                              vector<long> &sizes);
+
+  template <typename Metric>
+  void CalculateClusterDistances(utils::Matrix<float> &distances,
+                                 utils::Matrix<float> &clusterCenters);
+
+  // index of the nearest center to row, distances is scratch space of one
+  // entry per center and secondDistance is set to the distance of the second
+  // nearest center
+  template <typename Metric>
+  static int Nearest(const float *row, const utils::Matrix<float> &centers,
+                     float *distances, float &distance, float &secondDistance);
+
+  template <typename Metric>
+  utils::Matrix<float> FindStartingCenters(utils::Matrix<float> &data, int k);
+  // lowers the nearest squared distances of the rows of data with the rows
+  // chosen[from..], nearestCenters holds positions in chosen
+  template <typename Metric>
+  static void UpdateNearestCenters(utils::Matrix<float> &data,
+                                   vector<int> &chosen, size_t from,
+                                   vector<float> &nearestDistances,
+                                   vector<int> &nearestCenters);
+  // k centers of weighted points, by k-means++ and Lloyd iterations
+  template <typename Metric>
+  static utils::Matrix<float> ClusterWeighted(utils::Matrix<float> &points,
+                                              vector<double> &weights, int k);
+
+  static utils::Matrix<float> GetRandomSubset(utils::Matrix<float> &data,
+                                              int nofSamples);
+  // distinct random rows of data, the first holdOut.Rows() of them are held
+  // out of the sample. The sample of sparse data goes to sparseSample instead,
+  // in no particular order.
+  static void GetRandomSubset(const utils::ChunkedMatrix &data,
+                              const MiniBatchOptions &options,
+                              utils::Matrix<float> &sample,
+                              utils::SparseMatrix &sparseSample,
+                              utils::Matrix<float> &holdOut);
+  // up to nofRows distinct random rows of sample, made dense
+  static utils::Matrix<float> GetRandomSubset(const utils::SparseMatrix &sample,
+                                              int nofRows);
   static void SquareArray(vector<float> &a);
-  static void CopyArray(vector<vector<float>> &dataSource,
-                        vector<vector<float>> &dataDestination, int indexSource,
-                        int indexDestination);
-
-  static float GetEarthMoverDistance(vector<vector<float>> &data,
-                                     vector<vector<float>> &centers, int index1,
-                                     int index2);
-  static float GetL2Distance(vector<vector<float>> &data,
-                             vector<vector<float>> &centers, int index1,
-                             int index2);
+  static void CopyArray(utils::Matrix<float> &dataSource,
+                        utils::Matrix<float> &dataDestination,
+                        int indexSource, int indexDestination);
 };
 } // namespace poker
 #endif
@@ -1,6 +1,7 @@
 #ifndef __CLASS_TRAINER_MANAGER_H__
 #define __CLASS_TRAINER_MANAGER_H__
 
+#include "algorithm/checkpoint.h"
 #include "algorithm/trainer.h"
 #include "utils/utils.h"
 
@@ -11,6 +12,7 @@ class TrainerManager {
 public:
   const int threadCount;
   atomic<long> iterations;
+  vector<atomic<long>> threadIterations;
   vector<Trainer> trainers;
 
   TrainerManager();
@@ -42,8 +44,14 @@ private:
   atomic<long> SaveToDiskIntervalCountdown;
   atomic<long> TestGamesIntervalCountdown;
 
+  uint32_t abstractionFingerprint;
+
   void StartTrainer(int index);
-  void RunSingleThreadTasks(int index, int current_iterations);
+  void RunSingleThreadTasks(int index, long current_iterations);
+
+  TrainingProgress GetProgress();
+  void RestoreProgress(TrainingProgress &progress);
+  static uint32_t CalculateAbstractionFingerprint();
 };
 } // namespace poker
 
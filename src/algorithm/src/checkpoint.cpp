@@ -0,0 +1,245 @@
+#include "algorithm/checkpoint.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+#include <oneapi/tbb.h>
+
+namespace poker {
+namespace {
+template <typename T> void WriteValue(ostream &out, T value) {
+  out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T> T ReadValue(istream &in) {
+  T value;
+  if (!in.read(reinterpret_cast<char *>(&value), sizeof(value)))
+    throw runtime_error("Unexpected end of checkpoint file");
+  return value;
+}
+} // namespace
+
+void Checkpoint::Save(NodeMap &nodeMap, const TrainingProgress &progress,
+                      const string &filename) {
+  const size_t blockCount = NodeMap::subcnt();
+  auto headers = vector<BlockHeader>(blockCount);
+  auto payloads = vector<string>(blockCount);
+
+  oneapi::tbb::parallel_for((size_t)0, blockCount, [&](size_t i) {
+    string raw;
+    uint64_t entries = 0;
+    // training threads keep writing, so encode under the submap lock
+    nodeMap.with_submap(i, [&](const auto &submap) {
+      auto sorted = vector<const pair<const string, Infoset> *>();
+      sorted.reserve(submap.size());
+      for (auto &entry : submap)
+        sorted.push_back(&entry);
+      sort(sorted.begin(), sorted.end(),
+           [](auto a, auto b) { return a->first < b->first; });
+
+      raw = EncodeBlock(sorted);
+      entries = sorted.size();
+    });
+    payloads[i] = utils::CompressBlock(raw);
+    headers[i] = {raw.size(), payloads[i].size(), entries,
+                  utils::Checksum(payloads[i])};
+  });
+
+  // written under a temporary name so a crash never loses the last checkpoint
+  string partial = filename + ".tmp";
+  {
+    ofstream file(partial, ios::binary);
+    file.write(MAGIC.data(), MAGIC.size());
+    WriteValue<uint32_t>(file, VERSION);
+    auto progressData = EncodeProgress(progress);
+    WriteValue<uint64_t>(file, progressData.size());
+    file.write(progressData.data(), progressData.size());
+    WriteValue<uint64_t>(file, blockCount);
+    for (auto &header : headers) {
+      WriteValue(file, header.rawSize);
+      WriteValue(file, header.compressedSize);
+      WriteValue(file, header.entries);
+      WriteValue(file, header.checksum);
+    }
+    for (auto &payload : payloads)
+      file.write(payload.data(), payload.size());
+
+    if (!file)
+      throw runtime_error("Failed to write checkpoint " + filename);
+  }
+  if (rename(partial.c_str(), filename.c_str()))
+    throw runtime_error("Failed to write checkpoint " + filename);
+}
+
+void Checkpoint::Load(NodeMap &nodeMap, TrainingProgress &progress,
+                      const string &filename) {
+  if (!IsCheckpointFile(filename))
+    throw invalid_argument(filename + " is not a checkpoint file");
+  ifstream file(filename, ios::binary);
+  file.seekg(MAGIC.size());
+
+  auto version = ReadValue<uint32_t>(file);
+  if (version != VERSION)
+    throw runtime_error("Unsupported checkpoint version " +
+                        to_string(version));
+
+  string progressData(ReadValue<uint64_t>(file), '\0');
+  if (!file.read(progressData.data(), progressData.size()))
+    throw runtime_error("Unexpected end of checkpoint file");
+  progress = DecodeProgress(progressData);
+
+  auto blockCount = ReadValue<uint64_t>(file);
+  auto headers = vector<BlockHeader>(blockCount);
+  for (auto &header : headers) {
+    header.rawSize = ReadValue<uint64_t>(file);
+    header.compressedSize = ReadValue<uint64_t>(file);
+    header.entries = ReadValue<uint64_t>(file);
+    header.checksum = ReadValue<uint32_t>(file);
+  }
+
+  auto payloads = vector<string>(blockCount);
+  for (auto i = 0UL; i < blockCount; ++i) {
+    payloads[i].resize(headers[i].compressedSize);
+    if (!file.read(payloads[i].data(), payloads[i].size()))
+      throw runtime_error("Unexpected end of checkpoint file");
+  }
+
+  nodeMap.clear();
+  nodeMap.reserve(accumulate(
+      headers.begin(), headers.end(), 0UL,
+      [](uint64_t sum, BlockHeader &header) { return sum + header.entries; }));
+
+  oneapi::tbb::parallel_for((size_t)0, (size_t)blockCount, [&](size_t i) {
+    if (utils::Checksum(payloads[i]) != headers[i].checksum)
+      throw runtime_error("Checksum mismatch in checkpoint block " +
+                          to_string(i));
+    string raw = utils::DecompressBlock(payloads[i], headers[i].rawSize);
+    payloads[i] = string();
+    DecodeBlock(raw, headers[i].entries, nodeMap);
+  });
+}
+
+bool Checkpoint::IsCheckpointFile(const string &filename) {
+  ifstream file(filename, ios::binary);
+  string magic(MAGIC.size(), '\0');
+  return file.read(magic.data(), magic.size()) && magic == MAGIC;
+}
+
+string Checkpoint::EncodeBlock(
+    vector<const pair<const string, Infoset> *> &entries) {
+  string raw;
+  string_view previous;
+  for (auto entry : entries) {
+    auto &[key, infoset] = *entry;
+
+    // keys are sorted, so neighbours share most of their action history
+    size_t shared = 0;
+    size_t limit = min(previous.size(), key.size());
+    while (shared < limit && previous[shared] == key[shared])
+      shared++;
+    utils::PutVarint(raw, shared);
+    utils::PutVarint(raw, key.size() - shared);
+    raw.append(key, shared);
+
+    utils::PutVarint(raw, infoset.regret.size());
+    for (auto regret : infoset.regret)
+      utils::PutVarint(raw, EncodeRegret(regret));
+
+    utils::PutVarint(raw, infoset.actionCounter.size());
+    for (auto count : infoset.actionCounter)
+      utils::PutVarint(raw, utils::ZigZagEncode(count));
+
+    previous = key;
+  }
+  return raw;
+}
+
+void Checkpoint::DecodeBlock(string_view raw, uint64_t entries,
+                             NodeMap &nodeMap) {
+  size_t pos = 0;
+  string key;
+  for (auto i = 0UL; i < entries; ++i) {
+    auto shared = utils::GetVarint(raw, pos);
+    auto suffix = utils::GetVarint(raw, pos);
+    if (shared > key.size() || suffix > raw.size() - pos)
+      throw runtime_error("Corrupt checkpoint block");
+    key.resize(shared);
+    key.append(raw.substr(pos, suffix));
+    pos += suffix;
+
+    Infoset infoset;
+    auto regrets = utils::GetVarint(raw, pos);
+    if (regrets > raw.size() - pos)
+      throw runtime_error("Corrupt checkpoint block");
+    infoset.regret.resize(regrets);
+    for (auto &regret : infoset.regret)
+      regret = DecodeRegret(utils::GetVarint(raw, pos));
+
+    auto counters = utils::GetVarint(raw, pos);
+    if (counters > raw.size() - pos)
+      throw runtime_error("Corrupt checkpoint block");
+    infoset.actionCounter.resize(counters);
+    for (auto &count : infoset.actionCounter)
+      count = (int)utils::ZigZagDecode(utils::GetVarint(raw, pos));
+
+    nodeMap.emplace(key, move(infoset));
+  }
+  if (pos != raw.size())
+    throw runtime_error("Corrupt checkpoint block");
+}
+
+string Checkpoint::EncodeProgress(const TrainingProgress &progress) {
+  string raw;
+  utils::PutVarint(raw, progress.iterations);
+  utils::PutVarint(raw, progress.threadIterations.size());
+  for (auto t : progress.threadIterations)
+    utils::PutVarint(raw, t);
+  // countdowns can overshoot below zero
+  utils::PutVarint(raw, utils::ZigZagEncode(progress.strategyIntervalCountdown));
+  utils::PutVarint(raw, utils::ZigZagEncode(progress.discountIntervalCountdown));
+  utils::PutVarint(raw,
+                   utils::ZigZagEncode(progress.saveToDiskIntervalCountdown));
+  utils::PutVarint(raw, utils::ZigZagEncode(progress.testGamesIntervalCountdown));
+  utils::PutVarint(raw, progress.randomState.size());
+  raw.append(progress.randomState);
+  utils::PutVarint(raw, progress.abstractionFingerprint);
+  return raw;
+}
+
+TrainingProgress Checkpoint::DecodeProgress(string_view raw) {
+  TrainingProgress progress;
+  size_t pos = 0;
+  progress.iterations = utils::GetVarint(raw, pos);
+  auto threads = utils::GetVarint(raw, pos);
+  if (threads > raw.size() - pos)
+    throw runtime_error("Corrupt checkpoint progress");
+  progress.threadIterations.resize(threads);
+  for (auto &t : progress.threadIterations)
+    t = utils::GetVarint(raw, pos);
+  progress.strategyIntervalCountdown =
+      utils::ZigZagDecode(utils::GetVarint(raw, pos));
+  progress.discountIntervalCountdown =
+      utils::ZigZagDecode(utils::GetVarint(raw, pos));
+  progress.saveToDiskIntervalCountdown =
+      utils::ZigZagDecode(utils::GetVarint(raw, pos));
+  progress.testGamesIntervalCountdown =
+      utils::ZigZagDecode(utils::GetVarint(raw, pos));
+  auto randomStateSize = utils::GetVarint(raw, pos);
+  if (randomStateSize > raw.size() - pos)
+    throw runtime_error("Corrupt checkpoint progress");
+  progress.randomState = raw.substr(pos, randomStateSize);
+  pos += randomStateSize;
+  progress.abstractionFingerprint = utils::GetVarint(raw, pos);
+  return progress;
+}
+
+// floored regrets are very common and would otherwise cost 5 bytes each
+uint64_t Checkpoint::EncodeRegret(int value) {
+  return value == Global::regretFloor ? 0 : utils::ZigZagEncode(value) + 1;
+}
+
+int Checkpoint::DecodeRegret(uint64_t value) {
+  return value == 0 ? Global::regretFloor
+                    : (int)utils::ZigZagDecode(value - 1);
+}
+} // namespace poker
@@ -5,20 +5,17 @@ using namespace indicators;
 
 namespace poker {
 
-// distanceFunc should be unsquared, positive
-vector<int> Kmeans::Cluster(
-    function<float(vector<vector<float>> &, vector<vector<float>> &, int, int)>
-        distanceFunc,
-    vector<vector<float>> &data, int k, int nofRuns,
-    vector<int> &_bestCenters) {
-  std::cout << "K-means++ clustering " << data.size() << " elements into " << k
+template <typename Metric>
+vector<int> Kmeans::Cluster(utils::Matrix<float> &data, int k, int nofRuns,
+                            vector<int> &_bestCenters) {
+  std::cout << "K-means clustering " << data.Rows() << " elements into " << k
             << " clusters with " << nofRuns << " runs...";
 
   chrono::steady_clock::time_point start = chrono::steady_clock::now();
 
-  auto bestCenters = vector<int>(data.size());
+  auto bestCenters = vector<int>(data.Rows());
   auto recordCenters = vector<int>(
-      data.size()); // we return indices only, the centers are discarded
+      data.Rows()); // we return indices only, the centers are discarded
 
   // load previous indices if passed
   bool skipInit = false;
@@ -28,76 +25,159 @@ vector<int> Kmeans::Cluster(
     recordCenters = vector<int>(_bestCenters);
   }
   float recordDistance = FLT_MAX;
+  Metric::Prepare(data);
+
+  // a snapshot of this data continues its run from the assignments in it
+  auto checkpoint = KmeansCheckpoint();
+  if (!checkpointFilename.empty())
+    checkpoint.fingerprint =
+        Fingerprint<Metric>(Checksum(data), data.Rows(), data.Cols(), k);
+  if (LoadCheckpoint(checkpoint)) {
+    if (checkpoint.recordAssignments.size()) {
+      recordCenters = checkpoint.recordAssignments;
+      recordDistance = checkpoint.recordDistance;
+    }
+    if (checkpoint.assignments.size()) {
+      skipInit = true;
+      bestCenters = checkpoint.assignments;
+    }
+  }
 
-  for (auto run = 0; run < nofRuns; ++run) {
-    std::cout << "K-means++ starting clustering " << run << "/" << nofRuns
+  for (auto run = checkpoint.run; run < nofRuns; ++run) {
+    std::cout << "K-means starting clustering " << run << "/" << nofRuns
               << " runs..." << std::endl;
 
-    auto centers = vector<vector<float>>(k, vector<float>(data[0].size()));
-    float lastDistance = FLT_MAX;
+    auto centers = utils::Matrix<float>(k, data.Cols());
     bool distanceChanged = true;
 
     if (!skipInit) {
-      bestCenters = vector<int>(data.size());
-      centers = FindStartingCenters(distanceFunc, data, k);
-    } else {
+      bestCenters = vector<int>(data.Rows());
+      centers = FindStartingCenters<Metric>(data, k);
+    }
+
+    // sums and sizes of the clusters, updated as elements change cluster so
+    // only the reassigned elements are read again
+    auto sums = utils::Matrix<double>(k, data.Cols());
+    auto sizes = vector<long>(k);
+    auto threadSums = vector<utils::Matrix<double>>(
+        Global::NOF_THREADS, utils::Matrix<double>(k, data.Cols()));
+    auto threadSizes =
+        vector<vector<long>>(Global::NOF_THREADS, vector<long>(k));
+    SumClusters(data, bestCenters, threadSums, threadSizes);
+    ReduceClusterSums(threadSums, threadSizes, sums, sizes);
+    if (skipInit) {
       // find new cluster centers // todo: it isnt theoretically sound to take
       // the mean when using EMD distance metric
-      centers = CalculateNewCenters(data, bestCenters, k);
+      centers = CentersFromSums(sums, sizes);
       skipInit = false;
     }
 
-    auto centerCenterDistances = vector<vector<float>>(k, vector<float>(k));
+    auto centerCenterDistances = utils::Matrix<float>(k, k);
+    // Hamerly's bounds: upper on the distance to the assigned center, lower on
+    // the distance to any other center, both moved by the center drift
+    auto upperBounds = vector<float>(data.Rows(), FLT_MAX);
+    auto lowerBounds = vector<float>(data.Rows(), 0.0f);
+    // half the distance of each center to its nearest other center, no
+    // element closer than that to its center can be nearer to another one
+    auto halfGaps = vector<float>(k);
+    auto drift = vector<float>(k);
 
     while (distanceChanged) {
       // calculate cluster-cluster distances to use triangle inequality
-      CalculateClusterDistances(distanceFunc, centerCenterDistances, centers);
+      CalculateClusterDistances<Metric>(centerCenterDistances, centers);
+      for (auto c = 0; c < k; c++) {
+        halfGaps[c] = FLT_MAX;
+        for (auto m = 0; m < k; m++)
+          if (m != c)
+            halfGaps[c] = min(halfGaps[c], centerCenterDistances[c][m] / 2);
+      }
 
       // find closest cluster for each element
-      auto threadDistance = vector<long>(Global::NOF_THREADS);
+      auto threadReassigned = vector<long>(Global::NOF_THREADS);
+      auto threadDistances =
+          vector<vector<float>>(Global::NOF_THREADS, vector<float>(k));
       auto threadFunc = [&](int threadIdx, int itemIdx) {
-        // assume previous cluster was good, this is better for the triangle
-        // inequality
-        float distance =
-            distanceFunc(data, centers, itemIdx, bestCenters[itemIdx]);
         int bestIndex = bestCenters[itemIdx];
-
-        for (auto m = 0; m < k; m++) // go through centers
-        {
-          if (centerCenterDistances[bestIndex][m] < 2 * distance &&
-              bestIndex != m) {
-            float tempDistance = distanceFunc(data, centers, itemIdx, m);
-            if (tempDistance < distance) {
-              distance = tempDistance;
-              bestIndex = m;
-            }
+        float bound = max(halfGaps[bestIndex], lowerBounds[itemIdx]);
+        if (upperBounds[itemIdx] <= bound)
+          return;
+        // tighten the upper bound before looking at the other centers
+        upperBounds[itemIdx] = Metric::Distance(
+            data[itemIdx], centers[bestIndex], centers.Stride());
+        if (upperBounds[itemIdx] <= bound)
+          return;
+
+        int nearest = Nearest<Metric>(data[itemIdx], centers,
+                                      threadDistances[threadIdx].data(),
+                                      upperBounds[itemIdx], lowerBounds[itemIdx]);
+        if (nearest != bestIndex) {
+          bestCenters[itemIdx] = nearest;
+          threadReassigned[threadIdx]++;
+          auto &moved = threadSums[threadIdx];
+          for (auto m = 0UL; m < data.Cols(); m++) {
+            moved[bestIndex][m] -= data[itemIdx][m];
+            moved[nearest][m] += data[itemIdx][m];
           }
+          threadSizes[threadIdx][bestIndex]--;
+          threadSizes[threadIdx][nearest]++;
         }
-        bestCenters[itemIdx] = bestIndex;
-        threadDistance[threadIdx] += distance;
       };
-      utils::parallelise(data.size(), threadFunc);
-
-      float totalDistance =
-          accumulate(threadDistance.begin(), threadDistance.end(), 0.0L);
-      totalDistance = totalDistance / data.size();
-
-      centers = CalculateNewCenters(data, bestCenters, k);
-      float diff = lastDistance - totalDistance;
-      std::cout << "Current average distance: " << totalDistance
-                << " Improvement: " << diff << ", "
-                << 100.0 * (1.0 - totalDistance / lastDistance) << "%"
-                << std::endl;
-
-      if (totalDistance < recordDistance) {
-        recordDistance = totalDistance;
-        recordCenters = vector<int>(bestCenters);
+      utils::parallelise(data.Rows(), threadFunc);
+      long reassigned =
+          accumulate(threadReassigned.begin(), threadReassigned.end(), 0L);
+
+      ReduceClusterSums(threadSums, threadSizes, sums, sizes);
+      auto previousCenters = centers;
+      centers = CentersFromSums(sums, sizes);
+      for (auto c = 0; c < k; c++)
+        drift[c] =
+            Metric::Distance(previousCenters[c], centers[c], centers.Stride());
+      // every lower bound drops by the largest drift of another center
+      int mostDrifted = max_element(drift.begin(), drift.end()) - drift.begin();
+      float maxDrift = drift[mostDrifted], otherMaxDrift = 0.0f;
+      for (auto c = 0; c < k; c++)
+        if (c != mostDrifted)
+          otherMaxDrift = max(otherMaxDrift, drift[c]);
+      oneapi::tbb::parallel_for(0, (int)data.Rows(), [&](int itemIdx) {
+        int center = bestCenters[itemIdx];
+        upperBounds[itemIdx] += drift[center];
+        lowerBounds[itemIdx] -=
+            center == mostDrifted ? otherMaxDrift : maxDrift;
+      });
+
+      std::cout << "Reassigned elements: " << reassigned << ", "
+                << 100.0 * reassigned / data.Rows() << "%" << std::endl;
+      distanceChanged =
+          reassigned > stopClusterReassignedThreshold * data.Rows();
+
+      if (distanceChanged && CheckpointDue()) {
+        checkpoint.run = run;
+        checkpoint.assignments = bestCenters;
+        SaveCheckpoint(checkpoint);
       }
+    }
 
-      distanceChanged =
-          abs(diff) / lastDistance > stopClusterImprovementThreshold;
-      lastDistance = totalDistance;
+    // bounds skip most distances, so the run is scored in one exact pass
+    auto threadDistance = vector<double>(Global::NOF_THREADS);
+    utils::parallelise(data.Rows(), [&](int threadIdx, int itemIdx) {
+      threadDistance[threadIdx] += Metric::Distance(
+          data[itemIdx], centers[bestCenters[itemIdx]], centers.Stride());
+    });
+    float totalDistance =
+        accumulate(threadDistance.begin(), threadDistance.end(), 0.0) /
+        data.Rows();
+    std::cout << "Average distance: " << totalDistance << std::endl;
+
+    if (totalDistance < recordDistance) {
+      recordDistance = totalDistance;
+      recordCenters = vector<int>(bestCenters);
     }
+
+    checkpoint.run = run + 1;
+    checkpoint.assignments.clear();
+    checkpoint.recordAssignments = recordCenters;
+    checkpoint.recordDistance = recordDistance;
+    SaveCheckpoint(checkpoint);
   }
   std::cout << "Best distance found: " << recordDistance << std::endl;
   chrono::steady_clock::time_point end = chrono::steady_clock::now();
@@ -109,116 +189,468 @@ vector<int> Kmeans::Cluster(
   return recordCenters;
 }
 
-vector<int> Kmeans::ClusterEMD(vector<vector<float>> &data, int k, int nofRuns,
-                               vector<int> &_bestCenters) {
-  return Cluster(GetEarthMoverDistance, data, k, nofRuns, _bestCenters);
+vector<int> Kmeans::ClusterEMD(utils::Matrix<float> &data, int k,
+                               int nofRuns, vector<int> &_bestCenters) {
+  return Cluster<EMDDistance>(data, k, nofRuns, _bestCenters);
 }
 
-vector<int> Kmeans::ClusterL2(vector<vector<float>> &data, int k, int nofRuns,
+vector<int> Kmeans::ClusterL2(utils::Matrix<float> &data, int k, int nofRuns,
                               vector<int> &_bestCenters) {
-  return Cluster(GetL2Distance, data, k, nofRuns, _bestCenters);
+  return Cluster<L2Distance>(data, k, nofRuns, _bestCenters);
+}
+
+template <typename Metric>
+vector<int> Kmeans::ClusterMiniBatch(const utils::ChunkedMatrix &data, int k,
+                                     const MiniBatchOptions &options) {
+  std::cout << "Mini-batch k-means clustering " << data.Rows()
+            << " elements into " << k << " clusters..." << std::endl;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+  // a snapshot of this data continues training its centers, on a new sample
+  auto checkpoint = KmeansCheckpoint();
+  checkpoint.fingerprint =
+      Fingerprint<Metric>(data.Source(), data.Rows(), data.Cols(), k);
+  bool resumed = LoadCheckpoint(checkpoint);
+  auto centers = checkpoint.centers;
+
+  if (!checkpoint.trained) {
+    auto sample = utils::Matrix<float>();
+    auto sparseSample = utils::SparseMatrix();
+    auto holdOut = utils::Matrix<float>();
+    GetRandomSubset(data, options, sample, sparseSample, holdOut);
+    Metric::Prepare(sample);
+    Metric::Prepare(holdOut);
+    long sampleRows = data.Sparse() ? sparseSample.Rows() : sample.Rows();
+
+    if (!resumed && data.Sparse()) {
+      // as many rows as k-means|| samples from a dense sample
+      auto seedRows = GetRandomSubset(
+          sparseSample, max({(int)sqrt(sampleRows), 100000}));
+      Metric::Prepare(seedRows);
+      centers = FindStartingCenters<Metric>(seedRows, k);
+    } else if (!resumed) {
+      centers = FindStartingCenters<Metric>(sample, k);
+    }
+    // rows assigned to each center so far, a center moves towards a row by
+    // 1 / count so it stays the mean of all rows it was assigned
+    auto counts = resumed ? checkpoint.counts : vector<long>(k);
+    auto batch = vector<int>(options.batchSize);
+    auto nearest = vector<int>(options.batchSize);
+    // the rows of a batch from a sparse sample, dense and prepared. The
+    // distances run on dense rows, the SIMD kernels are far faster than
+    // walking the nonzero entries of a row.
+    auto batchRows = utils::Matrix<float>(
+        data.Sparse() ? options.batchSize : 0, data.Cols());
+    auto batchRow = [&](int i) -> const float * {
+      return data.Sparse() ? batchRows[i] : sample[batch[i]];
+    };
+
+    float bestDistance = checkpoint.bestDistance;
+    int evaluationsWithoutImprovement =
+        checkpoint.evaluationsWithoutImprovement;
+    for (auto iteration = checkpoint.iteration + 1;
+         iteration <= options.maxIterations &&
+         evaluationsWithoutImprovement < miniBatchPatience;
+         iteration++) {
+      for (auto &row : batch)
+        row = randint(0, sampleRows);
+
+      oneapi::tbb::parallel_for(
+          oneapi::tbb::blocked_range<int>(0, options.batchSize),
+          [&](const oneapi::tbb::blocked_range<int> &range) {
+            auto distances = vector<float>(k);
+            float distance, secondDistance;
+            for (auto i = range.begin(); i < range.end(); i++) {
+              if (data.Sparse()) {
+                sparseSample.Densify(batch[i], batchRows[i]);
+                Metric::PrepareRow(batchRows[i], batchRows.Cols());
+              }
+              nearest[i] = Nearest<Metric>(batchRow(i), centers,
+                                           distances.data(), distance,
+                                           secondDistance);
+            }
+          });
+
+      for (auto i = 0; i < options.batchSize; i++) {
+        float *center = centers[nearest[i]];
+        const float *row = batchRow(i);
+        float rate = 1.0f / ++counts[nearest[i]];
+        for (auto m = 0UL; m < centers.Cols(); m++)
+          center[m] += rate * (row[m] - center[m]);
+      }
+
+      if (iteration % options.evaluationInterval)
+        continue;
+
+      double totalDistance = oneapi::tbb::parallel_reduce(
+          oneapi::tbb::blocked_range<int>(0, holdOut.Rows()), 0.0,
+          [&](const oneapi::tbb::blocked_range<int> &range, double sum) {
+            auto distances = vector<float>(k);
+            float distance, secondDistance;
+            for (auto i = range.begin(); i < range.end(); i++) {
+              Nearest<Metric>(holdOut[i], centers, distances.data(), distance,
+                              secondDistance);
+              sum += distance;
+            }
+            return sum;
+          },
+          plus<double>());
+      float distance = totalDistance / holdOut.Rows();
+      std::cout << "Iteration " << iteration
+                << " held-out average distance: " << distance << std::endl;
+
+      if (distance < bestDistance * (1 - stopMiniBatchImprovementThreshold)) {
+        bestDistance = distance;
+        evaluationsWithoutImprovement = 0;
+      } else {
+        evaluationsWithoutImprovement++;
+      }
+
+      if (CheckpointDue()) {
+        checkpoint.iteration = iteration;
+        checkpoint.centers = centers;
+        checkpoint.counts = counts;
+        checkpoint.bestDistance = bestDistance;
+        checkpoint.evaluationsWithoutImprovement =
+            evaluationsWithoutImprovement;
+        SaveCheckpoint(checkpoint);
+      }
+    }
+
+    checkpoint.trained = true;
+    checkpoint.centers = centers;
+    SaveCheckpoint(checkpoint);
+  }
+
+  // one full pass assigns every row to its nearest final center, row(i, dense)
+  // returns row i of a chunk prepared, dense is a scratch row to fill
+  auto clusters = vector<int>(data.Rows());
+  double totalDistance = 0.0;
+  auto assign = [&](long begin, int nofRows, auto row) {
+    totalDistance += oneapi::tbb::parallel_reduce(
+        oneapi::tbb::blocked_range<int>(0, nofRows), 0.0,
+        [&](const oneapi::tbb::blocked_range<int> &range, double sum) {
+          auto distances = vector<float>(k);
+          auto dense = utils::Matrix<float>(1, data.Cols());
+          float distance, secondDistance;
+          for (auto i = range.begin(); i < range.end(); i++) {
+            clusters[begin + i] =
+                Nearest<Metric>(row(i, dense[0]), centers, distances.data(),
+                                distance, secondDistance);
+            sum += distance;
+          }
+          return sum;
+        },
+        plus<double>());
+  };
+  if (data.Sparse()) {
+    // only one row of a sparse chunk is dense at a time
+    data.ForEachSparseChunk([&](long begin, utils::SparseMatrix &rows) {
+      assign(begin, rows.Rows(), [&](int i, float *dense) {
+        rows.Densify(i, dense);
+        Metric::PrepareRow(dense, rows.Cols());
+        return (const float *)dense;
+      });
+    });
+  } else {
+    data.ForEachChunk([&](long begin, utils::Matrix<float> &rows) {
+      Metric::Prepare(rows);
+      assign(begin, rows.Rows(),
+             [&](int i, float *) { return (const float *)rows[i]; });
+    });
+  }
+  std::cout << "Average distance: " << totalDistance / data.Rows()
+            << std::endl;
+
+  chrono::steady_clock::time_point end = chrono::steady_clock::now();
+  auto elapsed =
+      chrono::duration_cast<std::chrono::seconds>(end - start).count();
+  cout << "Time taken to generate lookup table: " << elapsed << "[s]"
+       << std::endl;
+  return clusters;
+}
+
+vector<int> Kmeans::ClusterEMD(const utils::ChunkedMatrix &data, int k,
+                               const MiniBatchOptions &options) {
+  return ClusterMiniBatch<EMDDistance>(data, k, options);
 }
 
-vector<vector<float>> Kmeans::CalculateNewCenters(vector<vector<float>> &data,
-                                                  vector<int> &bestCenters,
-                                                  int k) {
-  auto centers = vector<vector<float>>(k, vector<float>(data[0].size()));
-  auto occurrences = vector<int>(k);
-  for (auto j = 0UL; j < data.size(); j++) {
-    for (auto m = 0UL; m < data[0].size(); ++m) {
-      centers[bestCenters[j]][m] += data[j][m];
+vector<int> Kmeans::ClusterL2(const utils::ChunkedMatrix &data, int k,
+                              const MiniBatchOptions &options) {
+  return ClusterMiniBatch<L2Distance>(data, k, options);
+}
+
+template <typename Metric>
+int Kmeans::Nearest(const float *row, const utils::Matrix<float> &centers,
+                    float *distances, float &distance, float &secondDistance) {
+  DistancesToCenters<Metric>(row, centers, distances);
+  int bestIndex = 0;
+  distance = FLT_MAX;
+  secondDistance = FLT_MAX;
+  for (auto m = 0; m < (int)centers.Rows(); m++) {
+    if (distances[m] < distance) {
+      secondDistance = distance;
+      distance = distances[m];
+      bestIndex = m;
+    } else if (distances[m] < secondDistance) {
+      secondDistance = distances[m];
     }
-    occurrences[bestCenters[j]]++;
   }
-  for (auto n = 0; n < k; ++n) {
-    for (auto m = 0UL; m < data[0].size(); ++m) {
-      if (occurrences[n] != 0)
-        centers[n][m] /= occurrences[n];
-      else
-        break;
+  return bestIndex;
+}
+
+void Kmeans::SumClusters(utils::Matrix<float> &data, vector<int> &bestCenters,
+                         vector<utils::Matrix<double>> &threadSums,
+                         vector<vector<long>> &threadSizes) {
+  oneapi::tbb::parallel_for(0, Global::NOF_THREADS, [&](int threadIdx) {
+    auto [startItemIdx, endItemIdx] = utils::GetWorkItemsIndices(
+        data.Rows(), Global::NOF_THREADS, threadIdx);
+    auto &sums = threadSums[threadIdx];
+    for (auto j = startItemIdx; j < endItemIdx; j++) {
+      for (auto m = 0UL; m < data.Cols(); ++m)
+        sums[bestCenters[j]][m] += data[j][m];
+      threadSizes[threadIdx][bestCenters[j]]++;
+    }
+  });
+}
+
+void Kmeans::ReduceClusterSums(vector<utils::Matrix<double>> &threadSums,
+                               vector<vector<long>> &threadSizes,
+                               utils::Matrix<double> &sums,
+                               vector<long> &sizes) {
+  oneapi::tbb::parallel_for(0, (int)sums.Rows(), [&](int n) {
+    for (auto t = 0UL; t < threadSums.size(); t++) {
+      for (auto m = 0UL; m < sums.Cols(); ++m) {
+        sums[n][m] += threadSums[t][n][m];
+        threadSums[t][n][m] = 0.0;
+      }
+      sizes[n] += threadSizes[t][n];
+      threadSizes[t][n] = 0;
     }
+  });
+}
+
+utils::Matrix<float> Kmeans::CentersFromSums(utils::Matrix<double> &sums,
+                                             vector<long> &sizes) {
+  auto centers = utils::Matrix<float>(sums.Rows(), sums.Cols());
+  for (auto n = 0UL; n < sums.Rows(); ++n) {
+    if (sizes[n] == 0)
+      continue;
+    for (auto m = 0UL; m < sums.Cols(); ++m)
+      centers[n][m] = sums[n][m] / sizes[n];
   }
   return centers;
 }
 
-void Kmeans::CalculateClusterDistances(
-    function<float(vector<vector<float>> &, vector<vector<float>> &, int, int)>
-        distanceFunc,
-    vector<vector<float>> &distances, vector<vector<float>> &clusterCenters) {
-  auto threadFunc = [&](int /*threadIdx*/, int itemIdx) {
+template <typename Metric>
+void Kmeans::CalculateClusterDistances(utils::Matrix<float> &distances,
+                                       utils::Matrix<float> &clusterCenters) {
+  // only k rows, too quick for a progress bar and done every mini-batch
+  oneapi::tbb::parallel_for(0, (int)clusterCenters.Rows(), [&](int itemIdx) {
     for (auto m = 0; m < itemIdx; ++m) {
       distances[itemIdx][m] =
-          distanceFunc(clusterCenters, clusterCenters, itemIdx, m);
+          Metric::Distance(clusterCenters[itemIdx], clusterCenters[m],
+                           clusterCenters.Stride());
       distances[m][itemIdx] = distances[itemIdx][m];
     }
-  };
-  utils::parallelise(clusterCenters.size(), threadFunc);
+  });
 }
 
-vector<vector<float>> Kmeans::FindStartingCenters(
-    function<float(vector<vector<float>> &, vector<vector<float>> &, int, int)>
-        distanceFunc,
-    vector<vector<float>> &data, int k) {
-  std::cout << "K-means++ finding good starting centers..." << std::endl;
+template <typename Metric>
+utils::Matrix<float> Kmeans::FindStartingCenters(utils::Matrix<float> &data,
+                                                 int k) {
+  std::cout << "K-means|| finding good starting centers..." << std::endl;
 
   // first get some samples of all data to speed up the algorithm
   int maxSamples =
-      min({max({(int)sqrt(data.size()), 100000}), (int)data.size()});
+      min({max({(int)sqrt(data.Rows()), 100000}), (int)data.Rows()});
   auto centerCandidates = GetRandomSubset(data, maxSamples);
 
-  auto centers = vector<vector<float>>(k, vector<float>(data[0].size()));
+  // squared distance of every candidate to its nearest chosen center and the
+  // position of that center in chosen
+  auto nearestDistances = vector<float>(centerCandidates.Rows(), FLT_MAX);
+  auto nearestCenters = vector<int>(centerCandidates.Rows());
+  auto chosen = vector<int>({randint(0, centerCandidates.Rows())});
+  UpdateNearestCenters<Metric>(centerCandidates, chosen, 0, nearestDistances,
+                               nearestCenters);
+
+  // k-means||, every round picks each candidate independently with
+  // probability proportional to its squared distance, about 2k per round
+  for (auto round = 0; round < seedingRounds; ++round) {
+    double cost = oneapi::tbb::parallel_reduce(
+        oneapi::tbb::blocked_range<size_t>(0, nearestDistances.size()), 0.0,
+        [&](const oneapi::tbb::blocked_range<size_t> &range, double sum) {
+          for (auto i = range.begin(); i < range.end(); i++)
+            sum += nearestDistances[i];
+          return sum;
+        },
+        plus<double>());
+    if (cost == 0.0)
+      break;
+
+    auto added = chosen.size();
+    for (auto i = 0UL; i < centerCandidates.Rows(); i++)
+      if (randDouble() < 2.0 * k * nearestDistances[i] / cost)
+        chosen.push_back(i);
+    UpdateNearestCenters<Metric>(centerCandidates, chosen, added,
+                                 nearestDistances, nearestCenters);
+    std::cout << "Round " << round + 1 << ": " << chosen.size()
+              << " center candidates" << std::endl;
+  }
 
-  // first cluster center is randomly chosen
-  auto usedCenters = unordered_set<int>();
-  int index = randint(0, centerCandidates.size());
-  CopyArray(centerCandidates, centers, index, 0);
-  usedCenters.insert(index);
+  // each chosen center stands for the candidates nearest to it
+  auto points = utils::Matrix<float>(chosen.size(), data.Cols());
+  auto weights = vector<double>(chosen.size());
+  for (auto i = 0UL; i < chosen.size(); i++)
+    CopyArray(centerCandidates, points, chosen[i], i);
+  for (auto nearest : nearestCenters)
+    weights[nearest]++;
+  return ClusterWeighted<Metric>(points, weights, k);
+}
 
-  for (auto c = 1; c < k; ++c) {
-    cout << "Finding center for " << c << "-th cluster" << endl;
-    auto distancesToNearestCenter =
-        vector<float>(centerCandidates.size(), FLT_MAX);
+template <typename Metric>
+void Kmeans::UpdateNearestCenters(utils::Matrix<float> &data,
+                                  vector<int> &chosen, size_t from,
+                                  vector<float> &nearestDistances,
+                                  vector<int> &nearestCenters) {
+  oneapi::tbb::parallel_for(
+      oneapi::tbb::blocked_range<size_t>(0, data.Rows()),
+      [&](const oneapi::tbb::blocked_range<size_t> &range) {
+        for (auto i = range.begin(); i < range.end(); i++) {
+          for (auto c = from; c < chosen.size(); c++) {
+            float distance =
+                Metric::Distance(data[i], data[chosen[c]], data.Stride());
+            if (distance * distance < nearestDistances[i]) {
+              nearestDistances[i] = distance * distance;
+              nearestCenters[i] = c;
+            }
+          }
+        }
+      });
+}
 
-    auto findDistanceToBestCenter = [&](int /*threadIdx*/, int itemIdx) {
-      if (usedCenters.contains(itemIdx)) {
-        distancesToNearestCenter[itemIdx] = 0;
-        return;
-      }
+template <typename Metric>
+utils::Matrix<float> Kmeans::ClusterWeighted(utils::Matrix<float> &points,
+                                             vector<double> &weights, int k) {
+  std::cout << "Clustering " << points.Rows() << " weighted candidates into "
+            << k << " starting centers..." << std::endl;
+  auto centers = utils::Matrix<float>(k, points.Cols());
+
+  // weighted k-means++, the distance to the nearest center is kept up to date
+  // with each new center, so no candidate is compared to a center twice
+  auto nearestDistances = vector<double>(points.Rows(), DBL_MAX);
+  auto probabilities = vector<double>(weights);
+  for (auto c = 0; c < k; ++c) {
+    double total = accumulate(probabilities.begin(), probabilities.end(), 0.0);
+    int next = randint(0, points.Rows());
+    if (total > 0.0) {
+      utils::normalise(probabilities);
+      next = SampleDistribution(probabilities);
+    }
+    CopyArray(points, centers, next, c);
+
+    oneapi::tbb::parallel_for(0, (int)points.Rows(), [&](int i) {
+      double distance =
+          Metric::Distance(points[i], centers[c], centers.Stride());
+      nearestDistances[i] = min(nearestDistances[i], distance * distance);
+      probabilities[i] = weights[i] * nearestDistances[i];
+    });
+  }
 
-      for (auto m = 0; m < c; ++m) {
-        float distanceToCenter =
-            distanceFunc(centerCandidates, centers, itemIdx, m);
-        distanceToCenter = distanceToCenter * distanceToCenter;
-        if (distanceToCenter < distancesToNearestCenter[itemIdx]) {
-          distancesToNearestCenter[itemIdx] = distanceToCenter;
-        }
-      }
-    };
-    utils::parallelise(centerCandidates.size(), findDistanceToBestCenter);
+  // weighted Lloyd iterations, there are only a few thousand candidates
+  auto assignments = vector<int>(points.Rows(), -1);
+  for (auto iteration = 0; iteration < maxWeightedIterations; iteration++) {
+    atomic<bool> changed = false;
+    oneapi::tbb::parallel_for(
+        oneapi::tbb::blocked_range<int>(0, points.Rows()),
+        [&](const oneapi::tbb::blocked_range<int> &range) {
+          auto distances = vector<float>(k);
+          float distance, secondDistance;
+          for (auto i = range.begin(); i < range.end(); i++) {
+            int nearest = Nearest<Metric>(points[i], centers, distances.data(),
+                                          distance, secondDistance);
+            if (nearest != assignments[i]) {
+              assignments[i] = nearest;
+              changed = true;
+            }
+          }
+        });
+    if (!changed)
+      break;
+
+    auto sums = utils::Matrix<double>(k, points.Cols());
+    auto sizes = vector<double>(k);
+    for (auto i = 0UL; i < points.Rows(); i++) {
+      for (auto m = 0UL; m < points.Cols(); m++)
+        sums[assignments[i]][m] += weights[i] * points[i][m];
+      sizes[assignments[i]] += weights[i];
+    }
+    for (auto c = 0; c < k; c++) {
+      if (sizes[c] == 0.0)
+        continue;
+      for (auto m = 0UL; m < points.Cols(); m++)
+        centers[c][m] = sums[c][m] / sizes[c];
+    }
+  }
+  return centers;
+}
 
-    // kmean++, choose next center based on weighted probability on squared
-    // distance
-    utils::normalise(distancesToNearestCenter);
+template <typename Metric>
+uint32_t Kmeans::Fingerprint(uint32_t data, long rows, size_t cols, int k) {
+  return utils::Checksum(Metric::NAME + " " + to_string(rows) + "x" +
+                             to_string(cols) + " k=" + to_string(k),
+                         data);
+}
+
+uint32_t Kmeans::Checksum(utils::Matrix<float> &data) {
+  uint32_t hash = utils::Checksum("");
+  for (auto row = 0UL; row < data.Rows(); row++)
+    hash = utils::Checksum(string_view((const char *)data[row],
+                                       data.Cols() * sizeof(float)),
+                           hash);
+  return hash;
+}
 
-    int nextCenterIndex = SampleDistribution(distancesToNearestCenter);
-    CopyArray(centerCandidates, centers, nextCenterIndex, c);
-    usedCenters.insert(nextCenterIndex);
+bool Kmeans::LoadCheckpoint(KmeansCheckpoint &checkpoint) {
+  if (checkpointFilename.empty() || !utils::FileExists(checkpointFilename))
+    return false;
+  auto saved = KmeansCheckpoint();
+  utils::LoadFromFile(saved, checkpointFilename);
+  if (saved.fingerprint != checkpoint.fingerprint) {
+    cout << "Ignoring " << checkpointFilename
+         << ", it was taken of other data" << endl;
+    return false;
   }
+  checkpoint = saved;
+  return true;
+}
 
-  return centers;
+bool Kmeans::CheckpointDue() const {
+  return !checkpointFilename.empty() &&
+         chrono::steady_clock::now() - lastCheckpoint >= checkpointInterval;
+}
+
+void Kmeans::SaveCheckpoint(const KmeansCheckpoint &checkpoint) {
+  if (checkpointFilename.empty())
+    return;
+  // written under a temporary name so a crash never leaves a partial snapshot
+  string partial = checkpointFilename + ".tmp";
+  utils::SaveToFile(checkpoint, partial);
+  if (rename(partial.c_str(), checkpointFilename.c_str()))
+    throw runtime_error("Failed to write " + checkpointFilename);
+  lastCheckpoint = chrono::steady_clock::now();
 }
 
 // return a subnet of length nofSamples of data, without repeating elements
-vector<vector<float>> Kmeans::GetRandomSubset(vector<vector<float>> &data,
-                                              int nofSamples) {
-  auto subset =
-      vector<vector<float>>(nofSamples, vector<float>(data[0].size()));
+utils::Matrix<float> Kmeans::GetRandomSubset(utils::Matrix<float> &data,
+                                             int nofSamples) {
+  auto subset = utils::Matrix<float>(nofSamples, data.Cols());
   unordered_set<int> numbers;
 
   int numbersLeft = nofSamples;
   int destinationIndex = 0;
   while (numbersLeft > 0) {
-    int rand = randint(0, data.size());
+    int rand = randint(0, data.Rows());
     if (!numbers.count(rand)) {
       numbers.insert(rand);
       numbersLeft--;
@@ -229,39 +661,93 @@ vector<vector<float>> Kmeans::GetRandomSubset(vector<vector<float>> &data,
   return subset;
 }
 
-void Kmeans::SquareArray(vector<float> &a) {
-  for (auto i = 0UL; i < a.size(); i++) {
-    a[i] *= a[i];
+void Kmeans::GetRandomSubset(const utils::ChunkedMatrix &data,
+                             const MiniBatchOptions &options,
+                             utils::Matrix<float> &sample,
+                             utils::SparseMatrix &sparseSample,
+                             utils::Matrix<float> &holdOut) {
+  long nofRows = min(data.Rows(), options.sampleSize + options.holdOutSize);
+  long nofHeldOut = min(options.holdOutSize, nofRows / 2);
+  std::cout << "Sampling " << nofRows - nofHeldOut << " rows and holding out "
+            << nofHeldOut << "..." << std::endl;
+
+  // distinct rows in the order they were drawn
+  auto rows = vector<int>();
+  if (2 * nofRows > data.Rows()) {
+    rows = vector<int>(data.Rows());
+    iota(rows.begin(), rows.end(), 0);
+    shuffle(rows.begin(), rows.end(), randintEngine());
+    rows.resize(nofRows);
+  } else {
+    unordered_set<int> numbers;
+    while ((long)rows.size() < nofRows) {
+      int rand = randint(0, data.Rows());
+      if (numbers.insert(rand).second)
+        rows.push_back(rand);
+    }
   }
-}
 
-void Kmeans::CopyArray(vector<vector<float>> &dataSource,
-                       vector<vector<float>> &dataDestination, int indexSource,
-                       int indexDestination) {
-  for (auto i = 0UL; i < dataSource[0].size(); ++i) {
-    dataDestination[indexDestination][i] = dataSource[indexSource][i];
+  // copied in row order, so the chunks are read once
+  auto order = vector<int>(nofRows);
+  iota(order.begin(), order.end(), 0);
+  sort(order.begin(), order.end(),
+       [&](int a, int b) { return rows[a] < rows[b]; });
+
+  holdOut = utils::Matrix<float>(nofHeldOut, data.Cols());
+  sample = utils::Matrix<float>(
+      data.Sparse() ? 0 : nofRows - nofHeldOut, data.Cols());
+  sparseSample = utils::SparseMatrix(data.Cols());
+  auto next = order.begin();
+  if (data.Sparse()) {
+    data.ForEachSparseChunk([&](long begin, utils::SparseMatrix &chunk) {
+      for (; next != order.end() && rows[*next] < begin + (long)chunk.Rows();
+           next++) {
+        // batches are drawn at random, so the row order does not matter
+        if (*next >= nofHeldOut)
+          sparseSample.AddRow(chunk, rows[*next] - begin);
+        else
+          chunk.Densify(rows[*next] - begin, holdOut[*next]);
+      }
+    });
+  } else {
+    data.ForEachChunk([&](long begin, utils::Matrix<float> &chunk) {
+      for (; next != order.end() && rows[*next] < begin + (long)chunk.Rows();
+           next++) {
+        const float *row = chunk[rows[*next] - begin];
+        float *destination =
+            *next < nofHeldOut ? holdOut[*next] : sample[*next - nofHeldOut];
+        copy(row, row + data.Cols(), destination);
+      }
+    });
   }
+  if (data.Sparse())
+    std::cout << "Kept " << sparseSample.NonZeros() << " nonzero entries of "
+              << sparseSample.Rows() * data.Cols() << std::endl;
 }
 
-float Kmeans::GetEarthMoverDistance(vector<vector<float>> &data,
-                                    vector<vector<float>> &centers, int index1,
-                                    int index2) {
-  float emd = 0, totalDistance = 0;
-  for (auto i = 0UL; i < data[0].size(); i++) {
-    emd = (data[index1][i] + emd) - centers[index2][i];
-    totalDistance += abs(emd);
-  }
-  return totalDistance;
+utils::Matrix<float> Kmeans::GetRandomSubset(const utils::SparseMatrix &sample,
+                                             int nofRows) {
+  auto rows = vector<int>(sample.Rows());
+  iota(rows.begin(), rows.end(), 0);
+  shuffle(rows.begin(), rows.end(), randintEngine());
+  rows.resize(min((size_t)nofRows, rows.size()));
+
+  auto subset = utils::Matrix<float>(rows.size(), sample.Cols());
+  for (auto i = 0UL; i < rows.size(); i++)
+    sample.Densify(rows[i], subset[i]);
+  return subset;
 }
 
-float Kmeans::GetL2Distance(vector<vector<float>> &data,
-                            vector<vector<float>> &centers, int index1,
-                            int index2) {
-  float totalDistance = 0;
-  for (auto i = 0UL; i < data[0].size(); i++) {
-    float diff = data[index1][i] - centers[index2][i];
-    totalDistance += diff * diff;
+void Kmeans::SquareArray(vector<float> &a) {
+  for (auto i = 0UL; i < a.size(); i++) {
+    a[i] *= a[i];
   }
-  return sqrt(totalDistance);
+}
+
+void Kmeans::CopyArray(utils::Matrix<float> &dataSource,
+                       utils::Matrix<float> &dataDestination, int indexSource,
+                       int indexDestination) {
+  auto source = dataSource.Row(indexSource);
+  copy(source.begin(), source.end(), dataDestination[indexDestination]);
 }
 } // namespace poker
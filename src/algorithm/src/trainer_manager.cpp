@@ -11,10 +11,12 @@ TrainerManager::TrainerManager() : TrainerManager(1) {}
 
 TrainerManager::TrainerManager(int threadCount)
     : threadCount{threadCount}, iterations{0},
+      threadIterations(threadCount),
       StrategyIntervalCountdown{StrategyInterval},
       DiscountIntervalCountdown{DiscountInterval},
       SaveToDiskIntervalCountdown{SaveToDiskInterval},
-      TestGamesIntervalCountdown{TestGamesInterval} {
+      TestGamesIntervalCountdown{TestGamesInterval},
+      abstractionFingerprint{CalculateAbstractionFingerprint()} {
   trainers = vector<Trainer>();
   for (auto i = 0; i < threadCount; i++) {
     trainers.push_back(Trainer());
@@ -35,7 +37,9 @@ void TrainerManager::StartTrainer(int index) {
   auto trainer = &trainers[index];
 
   chrono::steady_clock::time_point start = chrono::steady_clock::now();
-  for (auto t = 1;; t++) {
+  for (;;) {
+    // continues from the restored count when resuming a run
+    long t = ++threadIterations[index];
     for (auto traverser = 0; traverser < Global::nofPlayers; traverser++) {
       bool pruneEnabled = t > PruneThreshold;
       trainer->TrainOneIteration(traverser, pruneEnabled);
@@ -68,7 +72,7 @@ void TrainerManager::StartTrainer(int index) {
   }
 }
 
-void TrainerManager::RunSingleThreadTasks(int index, int current_iteration) {
+void TrainerManager::RunSingleThreadTasks(int index, long current_iteration) {
   auto trainer = &trainers[index];
 
   if (index == 0) {
@@ -146,9 +150,7 @@ void TrainerManager::SaveTrainedData() {
   filename << "nodeMap-" << epoch << ".bin";
   std::cout << "Saving trained data to file " << filename.str() << std::endl;
 
-  std::ofstream os(filename.str(), std::ios::binary);
-  cereal::BinaryOutputArchive ar(os);
-  ar(CEREAL_NVP(Global::nodeMap));
+  Checkpoint::Save(Global::nodeMap, GetProgress(), filename.str());
   std::cout << "Saved trained data" << std::endl;
 }
 
@@ -156,8 +158,73 @@ void TrainerManager::LoadTrainedData() {
   if (!utils::FileExists("nodeMap.bin"))
     return;
   std::cout << "Loading trained data from file nodeMap.bin..." << std::endl;
-  std::ifstream is("nodeMap.bin", std::ios::binary);
-  cereal::BinaryInputArchive ar(is);
-  ar(CEREAL_NVP(Global::nodeMap));
+  if (Checkpoint::IsCheckpointFile("nodeMap.bin")) {
+    TrainingProgress progress;
+    Checkpoint::Load(Global::nodeMap, progress, "nodeMap.bin");
+    RestoreProgress(progress);
+  } else {
+    // node maps written before the compressed checkpoint format
+    std::ifstream is("nodeMap.bin", std::ios::binary);
+    cereal::BinaryInputArchive ar(is);
+    ar(CEREAL_NVP(Global::nodeMap));
+  }
   std::cout << "Loaded trained data" << std::endl;
 }
+
+TrainingProgress TrainerManager::GetProgress() {
+  TrainingProgress progress;
+  progress.iterations = iterations;
+  for (auto &t : threadIterations)
+    progress.threadIterations.push_back(t);
+  progress.strategyIntervalCountdown = StrategyIntervalCountdown;
+  progress.discountIntervalCountdown = DiscountIntervalCountdown;
+  progress.saveToDiskIntervalCountdown = SaveToDiskIntervalCountdown;
+  progress.testGamesIntervalCountdown = TestGamesIntervalCountdown;
+  progress.randomState = getRandomState();
+  progress.abstractionFingerprint = abstractionFingerprint;
+  return progress;
+}
+
+void TrainerManager::RestoreProgress(TrainingProgress &progress) {
+  if (progress.abstractionFingerprint != abstractionFingerprint) {
+    throw runtime_error("nodeMap.bin was trained on different abstraction "
+                        "tables, refusing to resume");
+  }
+
+  iterations = progress.iterations;
+  StrategyIntervalCountdown = progress.strategyIntervalCountdown;
+  DiscountIntervalCountdown = progress.discountIntervalCountdown;
+  SaveToDiskIntervalCountdown = progress.saveToDiskIntervalCountdown;
+  TestGamesIntervalCountdown = progress.testGamesIntervalCountdown;
+  setRandomState(progress.randomState);
+
+  // with a different thread count, extra threads resume from the slowest one
+  auto &saved = progress.threadIterations;
+  long slowest = saved.size() ? *min_element(saved.begin(), saved.end()) : 0;
+  for (auto i = 0; i < threadCount; i++) {
+    threadIterations[i] = (size_t)i < saved.size() ? saved[i] : slowest;
+  }
+
+  std::cout << "Resuming training from iteration " << iterations << std::endl;
+}
+
+namespace {
+template <typename T>
+uint32_t FingerprintTable(const utils::ArtifactView<T> &table, uint32_t hash) {
+  // the header checksum covers the payload, no need to hash the table again
+  uint64_t id[] = {table.Checksum(), table.size()};
+  return utils::Checksum(string_view((const char *)id, sizeof(id)), hash);
+}
+} // namespace
+
+uint32_t TrainerManager::CalculateAbstractionFingerprint() {
+  auto buckets = vector<int>({Global::nofOpponentClusters,
+                              Global::nofRiverBuckets, Global::nofTurnBuckets,
+                              Global::nofFlopBuckets});
+  uint32_t hash = utils::Checksum(
+      string_view((const char *)buckets.data(), buckets.size() * sizeof(int)));
+  hash = FingerprintTable(OCHSTable::preflopIndices, hash);
+  hash = FingerprintTable(OCHSTable::riverIndices, hash);
+  hash = FingerprintTable(EMDTable::turnIndices, hash);
+  return FingerprintTable(EMDTable::flopIndices, hash);
+}
@@ -0,0 +1,43 @@
+#include "abstraction/global.h"
+#include "tables/abstraction_builder.h"
+
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+namespace poker {
+/// <summary>
+/// Builds the information abstraction tables the trainer loads
+///
+/// abstraction build [--force]  runs the stages that are out of date
+/// abstraction status           lists the stages that are out of date
+/// </summary>
+class AbstractionProgram {
+public:
+  static int Main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "build") == 0) {
+      auto force = argc > 2 && strcmp(argv[2], "--force") == 0;
+      AbstractionBuilder::CreateIndexers();
+      AbstractionBuilder(AbstractionBuilder::DefaultStages()).Build(force);
+      return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "status") == 0) {
+      auto outdated =
+          AbstractionBuilder(AbstractionBuilder::DefaultStages())
+              .OutdatedStages();
+      for (auto &name : outdated)
+        cout << name << " is out of date" << endl;
+      if (outdated.empty())
+        cout << "All stages are up to date" << endl;
+      return 0;
+    }
+    cerr << "Usage: " << argv[0] << " build [--force] | status" << endl;
+    return 1;
+  }
+};
+} // namespace poker
+
+int main(int argc, char **argv) {
+  return poker::AbstractionProgram::Main(argc, argv);
+}
@@ -11,6 +11,7 @@
 #include "algorithm/trainer_manager.h"
 #include "game/card.h"
 #include "game/deck.h"
+#include "tables/abstraction_builder.h"
 #include "tables/emd_table.h"
 #include "tables/hand_indexer.h"
 #include "tables/ochs_table.h"
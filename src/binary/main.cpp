@@ -4,9 +4,8 @@ namespace poker {
 class Program {
 public:
   static void Main(int argc, char **argv) {
-    CreateIndexers();
-    Global::handEvaluator->Initialise();
-    CalculateInformationAbstraction();
+    // the tables are built beforehand by `abstraction build`
+    AbstractionBuilder::LoadArtifacts();
 
     if (argc > 1 && strcmp(argv[1], "play") == 0) {
       StartGameForever();
@@ -37,45 +36,6 @@ public:
   }
 
 private:
-  static void CreateIndexers() {
-    HandIndexer::Initialise();
-    vector<int> cardsPerRound;
-
-    std::cout << "Creating 2 card index... " << std::endl;
-    cardsPerRound = vector<int>({2});
-    Global::indexer_2.Construct(cardsPerRound);
-    std::cout << Global::indexer_2.roundSize[0] << " non-isomorphic hands found"
-              << std::endl;
-
-    std::cout << "Creating 2 & 3 card index... " << std::endl;
-    cardsPerRound = vector<int>({2, 3});
-    Global::indexer_2_3.Construct(cardsPerRound);
-    std::cout << Global::indexer_2_3.roundSize[1]
-              << " non-isomorphic hands found" << std::endl;
-
-    std::cout << "Creating 2 & 4 card index... " << std::endl;
-    cardsPerRound = vector<int>({2, 4});
-    Global::indexer_2_4.Construct(cardsPerRound);
-    std::cout << Global::indexer_2_4.roundSize[1]
-              << " non-isomorphic hands found" << std::endl;
-
-    std::cout << "Creating 2 & 5 card index... " << std::endl;
-    cardsPerRound = vector<int>({2, 5});
-    Global::indexer_2_5.Construct(cardsPerRound);
-    std::cout << Global::indexer_2_5.roundSize[1]
-              << " non-isomorphic hands found" << std::endl;
-  }
-
-  static void CalculateInformationAbstraction() {
-    std::cout << "Calculating information abstractions... " << std::endl;
-
-    OCHSTable ochsTable = OCHSTable();
-    ochsTable.Init();
-
-    EMDTable emdTable = EMDTable();
-    emdTable.Init();
-  }
-
   static void Train() {
     auto trainerManager = TrainerManager(Global::NOF_THREADS);
     trainerManager.StartTraining();
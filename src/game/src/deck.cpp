@@ -14,7 +14,7 @@ int Deck::NumRemainingCards() {
 }
 
 void Deck::Shuffle() {
-  std::random_shuffle(cards.begin() + position, cards.end());
+  std::shuffle(cards.begin() + position, cards.end(), randintEngine());
 }
 
 ulong Deck::Draw(int count) {
@@ -0,0 +1,96 @@
+#ifndef __CLASS_ABSTRACTION_BUILDER_H__
+#define __CLASS_ABSTRACTION_BUILDER_H__
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace poker {
+/// <summary>
+/// One step of the abstraction build, writing its output files from what the
+/// stages it depends on produced. A stage without outputs only builds state in
+/// memory, e.g. the evaluator tables, and runs whenever a stage depending on it
+/// runs
+/// </summary>
+struct AbstractionStage {
+  string name;
+  vector<string> dependencies;
+  // everything besides the inputs that the outputs depend on, e.g. the
+  // number of buckets
+  string parameters;
+  vector<string> outputs;
+  function<void()> build;
+};
+
+/// <summary>
+/// Builds the information abstraction as a graph of stages, separately from
+/// training.
+///
+/// The manifest records for every stage built the checksums of its
+/// parameters, of its inputs and the checksum and size of each output file. A
+/// stage is up to date when its parameters and the outputs of its dependencies
+/// still match the manifest and its outputs are unchanged on disk, and up to
+/// date stages are skipped. Stages whose dependencies are done run in parallel.
+/// An artifact output is identified by the payload checksum in its header.
+/// </summary>
+class AbstractionBuilder {
+public:
+  inline static const string filenameManifest = "AbstractionManifest.txt";
+
+  AbstractionBuilder(const vector<AbstractionStage> &stages,
+                     const string &manifestFilename = filenameManifest);
+
+  // evaluator, preflop, river, turn and flop, as the trainer uses them
+  static vector<AbstractionStage> DefaultStages();
+
+  // runs every stage that is not up to date, or every stage if force
+  void Build(bool force = false);
+  // names of the stages with outputs that Build would run first, in order,
+  // without verify artifact payloads are trusted to match their header
+  vector<string> OutdatedStages(bool verify = true) const;
+
+  static void CreateIndexers();
+  // creates the indexers and the evaluator and loads the tables built by
+  // Build, throws runtime_error if the build is missing or out of date
+  static void LoadArtifacts();
+
+private:
+  struct ManifestOutput {
+    string filename;
+    uint32_t checksum = 0;
+    uint64_t size = 0;
+  };
+
+  struct ManifestEntry {
+    uint32_t parameters = 0;
+    uint32_t inputs = 0;
+    vector<ManifestOutput> outputs;
+    string description;
+  };
+
+  vector<AbstractionStage> stages;
+  string manifestFilename;
+  map<string, ManifestEntry> manifest;
+  mutex manifestMutex;
+  vector<once_flag> memoryStagesBuilt;
+
+  static uint32_t FileChecksum(const string &filename, uint64_t offset = 0);
+  static uint32_t OutputChecksum(const string &filename, bool verify);
+  void LoadManifest();
+  void SaveManifest() const;
+
+  size_t StageIndex(const string &name) const;
+  // the stages in sets, each depending only on stages of earlier sets
+  vector<vector<size_t>> Waves() const;
+  uint32_t InputsChecksum(size_t stage) const;
+  bool IsUpToDate(size_t stage, bool verify = true) const;
+  void Run(size_t stage);
+  void RunMemoryDependencies(size_t stage);
+};
+} // namespace poker
+#endif
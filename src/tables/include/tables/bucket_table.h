@@ -0,0 +1,93 @@
+#ifndef __CLASS_BUCKET_TABLE_H__
+#define __CLASS_BUCKET_TABLE_H__
+
+#include "utils/artifact.h"
+#include "utils/compression.h"
+#include "utils/utils.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+namespace poker {
+// narrowest unsigned type holding every bucket index below nofBuckets
+template <int nofBuckets>
+using BucketIndex = conditional_t<
+    nofBuckets <= 256, uint8_t,
+    conditional_t<nofBuckets <= 65536, uint16_t, uint32_t>>;
+
+/// <summary>
+/// Storage and serialization of a table mapping canonical hands to their
+/// cluster, one entry of width T per hand.
+///
+/// A table is saved as an artifact under its filename with the width
+/// appended, e.g. EMDFlopTable.u8.bin, holding the bucket count as its
+/// parameters, and loaded as a view of the mapped file. A table written as a
+/// boost archive by older builds, of width T or as vector<int> under the plain
+/// filename, is still loaded and saved again as an artifact.
+/// </summary>
+template <typename T> class BucketTable {
+  static_assert(is_unsigned_v<T>, "bucket indices are unsigned");
+
+public:
+  static string Filename(const string &filename) {
+    auto extension = filename.rfind('.');
+    return filename.substr(0, extension) + ".u" + to_string(8 * sizeof(T)) +
+           (extension == string::npos ? "" : filename.substr(extension));
+  }
+
+  static vector<T> Narrow(const vector<int> &indices) {
+    auto table = vector<T>(indices.size());
+    for (auto i = 0UL; i < indices.size(); i++) {
+      if (indices[i] < 0 || (ulong)indices[i] > numeric_limits<T>::max())
+        throw out_of_range("Bucket index " + to_string(indices[i]) +
+                           " does not fit the bucket table width");
+      table[i] = (T)indices[i];
+    }
+    return table;
+  }
+
+  // identifies the clustering that tables built from this one depend on
+  static uint32_t Checksum(const utils::ArtifactView<T> &table) {
+    return table.Checksum();
+  }
+
+  static bool Exists(const string &filename) {
+    return utils::FileExists(Filename(filename)) ||
+           utils::FileExists(filename);
+  }
+
+  static void Save(const vector<T> &table, const string &filename,
+                   int nofBuckets) {
+    if (table.size() && !utils::FileExists(Filename(filename)))
+      utils::SaveArtifact(Filename(filename), table, nofBuckets);
+  }
+
+  // leaves table empty if neither file exists, throws runtime_error if the
+  // table was built for another bucket count
+  static void Load(utils::ArtifactView<T> &table, const string &filename,
+                   int nofBuckets, bool verify = true) {
+    if (utils::IsArtifact(Filename(filename))) {
+      table = utils::LoadArtifact<T>(Filename(filename), nofBuckets, verify);
+      return;
+    }
+
+    if (!utils::FileExists(filename))
+      return;
+    auto indices = vector<int>();
+    utils::LoadFromFile(indices, filename);
+    cout << "Migrating " << filename << " to " << Filename(filename) << endl;
+    Save(Narrow(indices), filename, nofBuckets);
+    table = utils::LoadArtifact<T>(Filename(filename), nofBuckets);
+  }
+};
+} // namespace poker
+#endif
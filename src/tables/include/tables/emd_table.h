@@ -4,7 +4,11 @@
 #include "abstraction/global.h"
 #include "algorithm/kmeans.h"
 #include "game/hand.h"
+#include "tables/bucket_table.h"
 #include "tables/ochs_table.h"
+#include "utils/artifact.h"
+#include "utils/chunked_matrix.h"
+#include "utils/matrix.h"
 #include "utils/random.h"
 #include "utils/utils.h"
 
@@ -25,26 +29,41 @@ namespace poker {
 class EMDTable {
 
 public:
-  static vector<int>
-      flopIndices; // mapping each canonical flop hand (2+3 cards) to a cluster
-  static vector<int>
-      turnIndices; // mapping each canonical turn hand (2+4 cards) to a cluster
+  typedef BucketIndex<Global::nofFlopBuckets> FlopBucket;
+  typedef BucketIndex<Global::nofTurnBuckets> TurnBucket;
 
-  static vector<vector<float>> histogramsFlop;
-  static vector<vector<float>> histogramsTurn;
+  // mapping each canonical flop hand (2+3 cards) to a cluster
+  static utils::ArtifactView<FlopBucket> flopIndices;
+  // mapping each canonical turn hand (2+4 cards) to a cluster
+  static utils::ArtifactView<TurnBucket> turnIndices;
+
+  // only held in memory while clustering, generated in chunks on disk
+  static utils::Matrix<float> histogramsFlop;
 
   static const string filenameEMDTurnTable;
   static const string filenameEMDFlopTable;
   static const string filenameEMDFlopHistogram;
   static const string filenameEMDTurnHistogram;
+  static const string filenameEMDFlopKmeans;
+  static const string filenameEMDTurnKmeans;
 
-  static void Init();
-  static void SaveToFile();
-  static void LoadFromFile();
+  // stages of the abstraction build, see AbstractionBuilder
+  static void BuildTurnClusters();
+  static void BuildFlopClusters();
+  // throws runtime_error if the tables were not built, verify checks the
+  // payload checksums
+  static void Load(bool verify = true);
+  static void LoadFromFile(bool verify = true);
 
 private:
+  static utils::ChunkedMatrix TurnHistogramChunks();
+  static utils::ChunkedMatrix FlopHistogramChunks();
   static void GenerateTurnHistograms();
+  static void GenerateTurnHistograms(long begin,
+                                     utils::Matrix<float> &histograms);
   static void GenerateFlopHistograms();
+  static void GenerateFlopHistograms(long begin,
+                                     utils::Matrix<float> &histograms);
   static void ClusterTurn();
   static void ClusterFlop();
 };
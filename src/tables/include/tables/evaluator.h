@@ -1,57 +1,143 @@
 #ifndef __CLASS_EVALUATOR_H__
 #define __CLASS_EVALUATOR_H__
 
-#include "abstraction/global.h"
-#include "game/deck.h"
 #include "game/hand.h"
 #include "game/hand_strength.h"
 
-#include <chrono>
-#include <fstream>
-#include <iostream>
-#include <string>
-#include <sys/stat.h>
-#include <unordered_map>
-#ifdef __linux__
-#include <unistd.h>
-#endif
-#include <algorithm>
-
-#include <indicators/block_progress_bar.hpp>
-#include <indicators/cursor_control.hpp>
-#include <indicators/progress_bar.hpp>
-
-#include <boost/archive/binary_iarchive.hpp>
-#include <boost/archive/binary_oarchive.hpp>
-#include <boost/serialization/list.hpp>
-#include <boost/serialization/string.hpp>
-#include <boost/serialization/unordered_map.hpp>
-
-typedef unsigned int uint;
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <vector>
 
 using namespace std;
 
 namespace poker {
+/// <summary>
+/// Evaluates hands of up to 7 cards to their equivalence class, 0 (7-5-4-3-2
+/// offsuit) to 7461 (royal flush).
+///
+/// A hand holding 5 or more cards of one suit is looked up by the rank mask of
+/// that suit. Any other hand is valued by its rank multiset alone, which is
+/// hashed to a dense index from the per-rank card counts. Both tables are
+/// shared between instances and take about 160KB.
+/// </summary>
 class Evaluator {
 public:
-  void Initialise();
+  Evaluator();
+  virtual ~Evaluator() = default;
+
+  virtual void Initialise();
 
   virtual int Evaluate(ulong bitmap);
-  void SaveToFile(string &filename);
+  // values[i] = Evaluate(board | holeCards[i]) for 2-card holeCards and a
+  // board of at most 5 cards
+  virtual void EvaluateBatch(ulong board, span<const ulong> holeCards,
+                             span<int> values);
 
 private:
-  bool loaded;
-  unordered_map<ulong, ulong> handRankMap;
-  unordered_map<ulong, ulong> monteCarloMap;
-
-  void LoadFromFile(string &filename);
-  void GenerateFiveCardTable();
-  void GenerateHandValueTable(int comboSize);
-  void GenerateMonteCarloMap(int iterations);
+  friend class BoardState;
+
+  static const int RANKS = 13;
+  static const int SUITS = 4;
+  static const int MAX_CARDS = 7;
+  // one bit per rank of the suit at bit 0
+  static const ulong SUIT_MASK = 0x1111111111111ul;
+
+  inline static once_flag generated;
+  // best flush or straight flush, indexed by the 13-bit rank mask of a suit
+  inline static vector<uint16_t> flushTable;
+  // best hand of a rank multiset, indexed by RankHash
+  inline static vector<uint16_t> rankTable;
+  // hash contribution of a rank given its count and the cards still to place
+  inline static array<array<array<int, MAX_CARDS + 1>, RANKS>,
+                      SUITS + 1>
+      rankOffsets;
+  // first rankTable entry of the multisets with a given number of cards
+  inline static array<int, MAX_CARDS + 2> rankTableStart;
+
+  static void GenerateTables();
+  static void GenerateRankOffsets();
+  static int RankHash(const array<int, RANKS> &counts);
+
+  static inline int SuitRanks(ulong bitmap, int suit) {
+    // gather every 4th bit into a contiguous 13-bit mask
+    ulong x = (bitmap >> suit) & SUIT_MASK;
+    x = (x | (x >> 3)) & 0x0303030303030303ul;
+    x = (x | (x >> 6)) & 0x000F000F000F000Ful;
+    x = (x | (x >> 12)) & 0x000000FF000000FFul;
+    x = (x | (x >> 24)) & 0xFFFFul;
+    return (int)x;
+  }
+
+  // number of cards of each rank, one rank per nibble
+  static inline ulong NibbleCounts(ulong bitmap) {
+    ulong x = bitmap - ((bitmap >> 1) & 0x5555555555555555ul);
+    return (x & 0x3333333333333333ul) + ((x >> 2) & 0x3333333333333333ul);
+  }
+
+  static inline int RankHash(ulong bitmap) {
+    return CountsHash(NibbleCounts(bitmap));
+  }
+
+  static inline int CountsHash(ulong counts) {
+    // nibble r holds the cards of rank r and below, which never carries
+    ulong placed = counts * SUIT_MASK;
+    int hash = rankTableStart[(placed >> (4 * (RANKS - 1))) & 0xF];
+    for (auto rank = 0; rank < RANKS; rank++)
+      hash += rankOffsets[(counts >> (4 * rank)) & 0xF][rank]
+                         [(placed >> (4 * rank)) & 0xF];
+    return hash;
+  }
+
+#ifdef __x86_64__
+  // rank multiset values of the leading multiple of 4 hands, needs AVX2
+  __attribute__((target("avx2"))) static size_t
+  EvaluateRankBatch(ulong board, span<const ulong> holeCards, span<int> values);
+#endif
 };
 
-template <typename Iterator>
-inline bool next_combination(const Iterator first, Iterator k,
-                             const Iterator last);
+/// <summary>
+/// Hand values of one fixed board of at most 5 cards for any 2 hole cards.
+///
+/// Unless a flush is made the value only depends on the two hole card ranks,
+/// so the board is evaluated with each of the 169 rank pairs up front. Only a
+/// suit the board holds 3 cards of can make a flush. Scoring a completion is
+/// one table read, two if the board has a flush suit.
+/// </summary>
+class BoardState {
+public:
+  struct Completion {
+    ulong holeCards;
+    int value;
+  };
+
+  BoardState(ulong board);
+
+  ulong Board() const { return board; }
+
+  inline int Evaluate(ulong holeCards) const {
+    int low = __builtin_ctzl(holeCards) >> 2;
+    int high = (63 - __builtin_clzl(holeCards)) >> 2;
+    int value = pairValues[low * Evaluator::RANKS + high];
+    if (flushSuit >= 0) {
+      int suited = Evaluator::SuitRanks(holeCards, flushSuit);
+      if (boardSuitCards + __builtin_popcount(suited) >= 5)
+        value = Evaluator::flushTable[boardSuitRanks | suited];
+    }
+    return value;
+  }
+
+  // every pair of hole cards not on the board, weakest first
+  vector<Completion> SortedCompletions() const;
+
+private:
+  ulong board;
+  int flushSuit;
+  int boardSuitRanks;
+  int boardSuitCards;
+  // non flush value by the lower and higher hole card rank
+  array<uint16_t, Evaluator::RANKS * Evaluator::RANKS> pairValues;
+};
 } // namespace poker
 #endif
@@ -0,0 +1,75 @@
+#ifndef __CLASS_FLAT_EVALUATOR_H__
+#define __CLASS_FLAT_EVALUATOR_H__
+
+#include "tables/evaluator.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+namespace poker {
+/// <summary>
+/// Evaluator backend reading 7-card hands from one flat uint16_t array of all
+/// 52C7 hands, indexed by the colex rank of the hand bitmap (about 267MB).
+///
+/// The array is generated once into a file and mapped read-only, so loading is
+/// instant and the pages are shared by every process using the same file.
+/// Hands of any other size fall back to the table based Evaluator.
+/// </summary>
+class FlatEvaluator : public Evaluator {
+public:
+  FlatEvaluator(const string &filename = "HandRankTable7.bin");
+  ~FlatEvaluator();
+  FlatEvaluator(const FlatEvaluator &) = delete;
+  FlatEvaluator &operator=(const FlatEvaluator &) = delete;
+
+  void Initialise() override;
+
+  int Evaluate(ulong bitmap) override;
+  void EvaluateBatch(ulong board, span<const ulong> holeCards,
+                     span<int> values) override;
+
+  // colex rank of a 7-card bitmap among all 7-card bitmaps
+  static inline uint32_t ColexIndex(ulong bitmap) {
+    uint32_t index = 0;
+    for (auto k = 1; k <= HAND_CARDS; k++) {
+      index += binomials[__builtin_ctzl(bitmap)][k];
+      bitmap &= bitmap - 1;
+    }
+    return index;
+  }
+
+  // inverse of ColexIndex
+  static ulong ColexBitmap(uint32_t index);
+
+  // fills the table in parallel over ranges of colex indices
+  static void Generate(const string &filename);
+
+private:
+  static const int HAND_CARDS = 7;
+  static const uint32_t ENTRIES = 133784560; // 52C7
+  inline static const string MAGIC = "RANK7TBL";
+  // magic and entry count in front of the array
+  static const size_t HEADER_SIZE = 16;
+
+  static constexpr auto binomials = [] {
+    array<array<uint32_t, HAND_CARDS + 1>, 52> table{};
+    for (auto n = 0; n < 52; n++) {
+      table[n][0] = 1;
+      for (auto k = 1; k <= HAND_CARDS; k++)
+        table[n][k] = n ? table[n - 1][k - 1] + table[n - 1][k] : 0;
+    }
+    return table;
+  }();
+
+  string filename;
+  const uint16_t *table;
+  void *mapping;
+  size_t mappingSize;
+
+  void Map();
+};
+} // namespace poker
+#endif
@@ -3,8 +3,11 @@
 
 #include "abstraction/global.h"
 
+#include <array>
 #include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <span>
 #include <stdexcept>
 #include <vector>
 
@@ -14,12 +17,14 @@ namespace poker {
 class HandIndexerState {
 
 public:
+  static const int SUITS = 4;
+
   int round;
   int permutationIndex;
   int permutationMultiplier;
-  vector<int> suitIndex;
-  vector<int> suitMultiplier;
-  vector<int> usedRanks;
+  array<int, SUITS> suitIndex;
+  array<int, SUITS> suitMultiplier;
+  array<int, SUITS> usedRanks;
 
   HandIndexerState();
 };
@@ -34,25 +39,45 @@ public:
 
   HandIndexer();
   void Construct(vector<int> &cardsPerRound);
-  static void Initialise();
 
-  long IndexAllRounds(vector<int> &cards, vector<long> &indices);
-  long IndexLastRound(vector<int> &cards);
-  long IndexNextRound(HandIndexerState &state, vector<int> &cards);
+  // cards are the card indices of all rounds so far, none may be negative.
+  // Indexing does not allocate or throw.
+  long IndexAllRounds(span<const int> cards, span<long> indices);
+  long IndexLastRound(span<const int> cards);
+  long IndexNextRound(HandIndexerState &state, span<const int> cards);
+  long RoundIndex(const HandIndexerState &state) const;
+  static void AdvanceState(HandIndexerState &state, int roundCards,
+                           const array<int, HandIndexerState::SUITS> &ranks,
+                           const array<int, HandIndexerState::SUITS> &shiftedRanks);
   bool Unindex(int round, long index, vector<int> &cards);
 
 private:
-  const static int MAX_GROUP_INDEX = 0x1000000;
+  friend class HandEnumerator;
+
   const static int ROUND_SHIFT = 4;
   const static int ROUND_MASK = 0xf;
 
-  static vector<vector<int>> nthUnset;
-  static vector<vector<bool>> equal;
-  static vector<vector<int>> nCrRanks; // cache of nCr calculation
-  static vector<int> rankSetToIndex;
-  static vector<vector<int>> indexToRankSet;
-  static vector<vector<int>> suitPermutations;
-  static vector<vector<long>> nCrGroups; // cache of nCr calculation
+  static const int RANKS = 13;
+  static const int SUITS = HandIndexerState::SUITS;
+  static const int PERMUTATIONS = 24; // SUITS!
+
+  // the rank and suit tables only depend on the deck and are built at compile
+  // time
+  static const array<array<uint8_t, RANKS>, 1 << RANKS> nthUnset;
+  static const array<array<bool, SUITS>, 1 << (SUITS - 1)> equal;
+  static const array<array<int, RANKS + 1>, RANKS + 1> nCrRanks;
+  static const array<int, 1 << RANKS> rankSetToIndex;
+  static const array<array<int, 1 << RANKS>, RANKS + 1> indexToRankSet;
+  static const array<array<int, SUITS>, PERMUTATIONS> suitPermutations;
+
+  // n choose k for a group of k <= SUITS suits of equal configuration, n is
+  // up to a suit's number of rank sets which is too large to tabulate
+  static inline long NCrGroups(long n, int k) {
+    long result = 1;
+    for (auto i = 0; i < k; i++)
+      result = result * (n - i) / (i + 1);
+    return result;
+  }
 
   vector<int> roundStart;
   vector<vector<int>> permutationToConfiguration;
@@ -64,9 +89,25 @@ private:
   vector<vector<int>>
       publicFlopHands; // map idx (from IndexLast) to canonical flop cards
 
-  static void CacheNCRCalculation();
-
-  void Swap(vector<int> &suitIndex, int u, int v);
+  static inline void Swap(array<int, HandIndexerState::SUITS> &suitIndex,
+                          int u, int v) {
+    int low = min(suitIndex[u], suitIndex[v]);
+    suitIndex[v] = max(suitIndex[u], suitIndex[v]);
+    suitIndex[u] = low;
+  }
+
+  // an index of a round is the offset of its configuration plus the position
+  // within it, the lowest group of suits of equal configuration varying
+  // fastest
+  int ConfigurationOf(int round, long index) const;
+  int SuitGroupEnd(int round, int configurationIdx, int first) const;
+  long SuitGroupSize(int round, int configurationIdx, int first,
+                     int end) const;
+  void UnrankSuitGroup(int round, int configurationIdx, int first, int end,
+                       long groupIndex, array<long, SUITS> &suitIndex) const;
+  // writes the cards of one suit where Unindex places them
+  void SuitCards(int round, int configurationIdx, int suit, long suitIndex,
+                 span<int> cards) const;
 
   void CreatePublicFlopHands();
   void EnumerateConfigurations(bool tabulate);
@@ -82,5 +123,65 @@ private:
   void TabulatePermutations(int round, vector<int> &count);
   void CountPermutations(int round, vector<int> &count);
 };
+
+/// <summary>
+/// Walks the canonical hands of one round in index order, giving the same
+/// cards as Unindex. Stepping only unranks the groups of suits whose position
+/// changes, usually just the first, so a range of hands costs one Unindex and
+/// then constant work per hand without allocating.
+/// </summary>
+class HandEnumerator {
+public:
+  HandEnumerator(const HandIndexer &indexer, int round, long index = 0);
+
+  long Index() const { return index; }
+  bool Done() const { return index >= indexer->roundSize[round]; }
+  // the cards of every round up to round
+  const vector<int> &Cards() const { return cards; }
+  void Next();
+
+private:
+  static const int SUITS = HandIndexerState::SUITS;
+
+  const HandIndexer *indexer;
+  int round;
+  long index;
+  int configurationIdx;
+  // by the first suit of each group of equal configuration
+  array<int, SUITS> groupEnd;
+  array<long, SUITS> groupSize;
+  array<long, SUITS> groupIndex;
+  array<long, SUITS> suitIndex;
+  vector<int> cards;
+
+  void StartConfiguration(long position);
+  void SetGroup(int first, long position);
+};
+
+/// <summary>
+/// Canonical index of one hand while its board is dealt card by card.
+///
+/// The hole cards are folded into the state once. Board cards are only shifted
+/// by the hole card ranks, so each dealt card is added to per-suit rank masks
+/// in constant time. A street is finished on the indexer whose last round is
+/// the whole board so far (e.g. indexer_2_3, indexer_2_4, indexer_2_5), which
+/// gives exactly the indices the bucket tables are stored under.
+/// </summary>
+class StreetIndexer {
+public:
+  StreetIndexer();
+  StreetIndexer(int card1, int card2);
+
+  void Deal(int card);
+  // indexer must deal the 2 hole cards and then the board dealt so far, before
+  // the flop that is indexer_2
+  long Index(const HandIndexer &indexer) const;
+
+private:
+  HandIndexerState hole;
+  int boardCards;
+  array<int, HandIndexerState::SUITS> boardRanks;
+  array<int, HandIndexerState::SUITS> shiftedBoardRanks;
+};
 } // namespace poker
 #endif
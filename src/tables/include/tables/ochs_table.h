@@ -3,11 +3,18 @@
 
 #include "abstraction/global.h"
 #include "algorithm/kmeans.h"
+#include "tables/bucket_table.h"
+#include "tables/evaluator.h"
+#include "tables/hand_indexer.h"
+#include "utils/artifact.h"
+#include "utils/chunked_matrix.h"
+#include "utils/matrix.h"
 #include "utils/random.h"
 #include "utils/utils.h"
 
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/archive/binary_oarchive.hpp>
+#include <array>
 #include <boost/serialization/vector.hpp>
 #include <chrono>
 #include <indicators/block_progress_bar.hpp>
@@ -23,25 +30,50 @@ namespace poker {
 class OCHSTable {
 
 public:
-  static vector<int> preflopIndices;
-  static vector<int> riverIndices;
+  typedef BucketIndex<Global::nofRiverBuckets> RiverBucket;
 
-  static vector<vector<float>> histogramsPreflop;
-  static vector<vector<float>> histogramsRiver;
+  static utils::ArtifactView<int> preflopIndices;
+  static utils::ArtifactView<RiverBucket> riverIndices;
+
+  static utils::Matrix<float> histogramsPreflop;
 
   static const string filenameOppClusters;
   static const string filenameRiverClusters;
   static const string filenameRiverHistograms;
+  static const string filenameRiverKmeans;
+
+  // stages of the abstraction build, see AbstractionBuilder
+  static void BuildPreflopClusters();
+  static void BuildRiverClusters();
+  // throws runtime_error if the tables were not built, verify checks the
+  // payload checksums
+  static void Load(bool verify = true);
 
-  static void Init();
+  // river histograms of every hero on one board, wins plus half the ties
+  // against each opponent cluster, in the order of the board's sorted
+  // completions. Opponent clusters are by card1 * CARDS + card2, card1 lower.
+  static void BoardHistograms(const vector<BoardState::Completion> &completions,
+                              const vector<int> &opponentClusters,
+                              vector<float> &histograms);
+  // twice the wins plus the ties of every hero on one board against all
+  // opponents sharing no card with it, in the order of the sorted completions
+  static void BoardEquities(const vector<BoardState::Completion> &completions,
+                            vector<int> &equities);
+  // number of boards the suit permutations map board to, itself included
+  static int SuitIsomorphicBoards(ulong board);
 
 private:
   static void CalculateOCHSOpponentClusters();
   static void ClusterPreflopHands();
   static void ClusterRiver();
+  static utils::ChunkedMatrix RiverHistogramChunks();
   static void GenerateRiverHistograms();
-  static void SaveToFile();
-  static void LoadFromFile();
+  static void GenerateRiverHistograms(long begin,
+                                      utils::Matrix<float> &histograms,
+                                      const vector<int> &opponentClusters);
+  // all 1326 two card bitmaps, in the order of the old opponent loops
+  static vector<ulong> AllOpponentHands();
+  static void LoadFromFile(bool verify = true);
 };
 } // namespace poker
 
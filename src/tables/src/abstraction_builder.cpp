@@ -0,0 +1,340 @@
+#include "tables/abstraction_builder.h"
+#include "abstraction/global.h"
+#include "tables/bucket_table.h"
+#include "tables/emd_table.h"
+#include "tables/ochs_table.h"
+#include "utils/artifact.h"
+#include "utils/compression.h"
+#include "utils/utils.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <oneapi/tbb.h>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace poker {
+AbstractionBuilder::AbstractionBuilder(const vector<AbstractionStage> &stages,
+                                       const string &manifestFilename)
+    : stages{stages}, manifestFilename{manifestFilename},
+      memoryStagesBuilt(stages.size()) {
+  for (auto &stage : stages)
+    for (auto &dependency : stage.dependencies)
+      StageIndex(dependency);
+  Waves();
+  LoadManifest();
+}
+
+vector<AbstractionStage> AbstractionBuilder::DefaultStages() {
+  // outputs of another artifact version are rebuilt
+  auto format = "format=" + to_string(utils::ARTIFACT_VERSION) + " ";
+  auto buckets = [&](int n) { return format + "buckets=" + to_string(n); };
+  return {
+      {"evaluator",
+       {},
+       "flat=" + to_string(Global::flatHandEvaluator),
+       {},
+       [] { Global::handEvaluator->Initialise(); }},
+      {"preflop",
+       {"evaluator"},
+       format +
+           "opponentClusters=" + to_string(Global::nofOpponentClusters) +
+           " histogramSize=" + to_string(Global::preflopHistogramSize) +
+           " boards=exact",
+       {OCHSTable::filenameOppClusters},
+       [] { OCHSTable::BuildPreflopClusters(); }},
+      {"river",
+       {"evaluator", "preflop"},
+       buckets(Global::nofRiverBuckets),
+       {BucketTable<OCHSTable::RiverBucket>::Filename(
+           OCHSTable::filenameRiverClusters)},
+       [] { OCHSTable::BuildRiverClusters(); }},
+      {"turn",
+       {"river"},
+       buckets(Global::nofTurnBuckets),
+       {BucketTable<EMDTable::TurnBucket>::Filename(
+           EMDTable::filenameEMDTurnTable)},
+       [] { EMDTable::BuildTurnClusters(); }},
+      {"flop",
+       {"turn"},
+       buckets(Global::nofFlopBuckets),
+       {BucketTable<EMDTable::FlopBucket>::Filename(
+           EMDTable::filenameEMDFlopTable)},
+       [] { EMDTable::BuildFlopClusters(); }},
+  };
+}
+
+void AbstractionBuilder::Build(bool force) {
+  for (auto &wave : Waves()) {
+    auto outdated = vector<size_t>();
+    for (auto stage : wave) {
+      if (stages[stage].outputs.empty())
+        continue;
+      if (force || !IsUpToDate(stage))
+        outdated.push_back(stage);
+      else
+        cout << "Stage " << stages[stage].name << " is up to date" << endl;
+    }
+
+    // the stages of a wave only depend on stages of earlier waves
+    oneapi::tbb::task_group group;
+    for (auto stage : outdated)
+      group.run([this, stage] { Run(stage); });
+    group.wait();
+  }
+}
+
+vector<string> AbstractionBuilder::OutdatedStages(bool verify) const {
+  auto outdated = vector<string>();
+  auto isOutdated = vector<bool>(stages.size(), false);
+  for (auto &wave : Waves()) {
+    for (auto stage : wave) {
+      for (auto &dependency : stages[stage].dependencies)
+        if (isOutdated[StageIndex(dependency)])
+          isOutdated[stage] = true;
+      if (stages[stage].outputs.empty())
+        continue;
+      if (!isOutdated[stage])
+        isOutdated[stage] = !IsUpToDate(stage, verify);
+      if (isOutdated[stage])
+        outdated.push_back(stages[stage].name);
+    }
+  }
+  return outdated;
+}
+
+void AbstractionBuilder::CreateIndexers() {
+  vector<int> cardsPerRound;
+
+  std::cout << "Creating 2 card index... " << std::endl;
+  cardsPerRound = vector<int>({2});
+  Global::indexer_2.Construct(cardsPerRound);
+  std::cout << Global::indexer_2.roundSize[0] << " non-isomorphic hands found"
+            << std::endl;
+
+  std::cout << "Creating 2 & 3 card index... " << std::endl;
+  cardsPerRound = vector<int>({2, 3});
+  Global::indexer_2_3.Construct(cardsPerRound);
+  std::cout << Global::indexer_2_3.roundSize[1] << " non-isomorphic hands found"
+            << std::endl;
+
+  std::cout << "Creating 2 & 4 card index... " << std::endl;
+  cardsPerRound = vector<int>({2, 4});
+  Global::indexer_2_4.Construct(cardsPerRound);
+  std::cout << Global::indexer_2_4.roundSize[1] << " non-isomorphic hands found"
+            << std::endl;
+
+  std::cout << "Creating 2 & 5 card index... " << std::endl;
+  cardsPerRound = vector<int>({2, 5});
+  Global::indexer_2_5.Construct(cardsPerRound);
+  std::cout << Global::indexer_2_5.roundSize[1] << " non-isomorphic hands found"
+            << std::endl;
+}
+
+void AbstractionBuilder::LoadArtifacts() {
+  // only the artifact headers are compared with the manifest, `abstraction
+  // status` and `build` hash the payloads
+  auto outdated = AbstractionBuilder(DefaultStages()).OutdatedStages(false);
+  if (outdated.size()) {
+    string names;
+    for (auto &name : outdated)
+      names += " " + name;
+    throw runtime_error("Abstraction stages out of date:" + names +
+                        ", run `abstraction build` first");
+  }
+
+  CreateIndexers();
+  Global::handEvaluator->Initialise();
+  std::cout << "Loading information abstractions... " << std::endl;
+  OCHSTable::Load(false);
+  EMDTable::Load(false);
+}
+
+uint32_t AbstractionBuilder::FileChecksum(const string &filename,
+                                          uint64_t offset) {
+  ifstream file(filename, ios::binary);
+  if (!file.seekg(offset))
+    throw runtime_error("Failed to read " + filename);
+  auto hash = utils::Checksum("");
+  auto buffer = vector<char>(1 << 20);
+  while (file.read(buffer.data(), buffer.size()) || file.gcount())
+    hash = utils::Checksum(string_view(buffer.data(), file.gcount()), hash);
+  return hash;
+}
+
+// the payload checksum of an artifact, read from its header unless verify
+uint32_t AbstractionBuilder::OutputChecksum(const string &filename,
+                                            bool verify) {
+  auto header = utils::ArtifactHeader();
+  if (!utils::ReadArtifactHeader(filename, header))
+    return FileChecksum(filename);
+  return verify ? FileChecksum(filename, header.payloadOffset)
+                : header.checksum;
+}
+
+// one line per stage: name, parameters checksum, inputs checksum, number of
+// outputs, every output with its checksum and size and the parameters as text
+void AbstractionBuilder::LoadManifest() {
+  ifstream file(manifestFilename);
+  string line;
+  while (getline(file, line)) {
+    auto stream = stringstream(line);
+    string name;
+    size_t nofOutputs;
+    auto entry = ManifestEntry();
+    if (!(stream >> name >> entry.parameters >> entry.inputs >> nofOutputs))
+      throw runtime_error("Malformed line in " + manifestFilename + ": " +
+                          line);
+    for (auto i = 0UL; i < nofOutputs; i++) {
+      auto output = ManifestOutput();
+      if (!(stream >> output.filename >> output.checksum >> output.size))
+        throw runtime_error("Malformed line in " + manifestFilename + ": " +
+                            line);
+      entry.outputs.push_back(output);
+    }
+    stream >> ws;
+    getline(stream, entry.description);
+    manifest[name] = entry;
+  }
+}
+
+void AbstractionBuilder::SaveManifest() const {
+  // written under a temporary name so an interrupted write keeps the old one
+  auto partial = manifestFilename + ".tmp";
+  {
+    ofstream file(partial);
+    for (auto &[name, entry] : manifest) {
+      file << name << " " << entry.parameters << " " << entry.inputs << " "
+           << entry.outputs.size();
+      for (auto &output : entry.outputs)
+        file << " " << output.filename << " " << output.checksum << " "
+             << output.size;
+      file << " " << entry.description << "\n";
+    }
+    if (!file)
+      throw runtime_error("Failed to write " + manifestFilename);
+  }
+  if (rename(partial.c_str(), manifestFilename.c_str()))
+    throw runtime_error("Failed to write " + manifestFilename);
+}
+
+size_t AbstractionBuilder::StageIndex(const string &name) const {
+  for (auto i = 0UL; i < stages.size(); i++)
+    if (stages[i].name == name)
+      return i;
+  throw invalid_argument("Unknown abstraction stage " + name);
+}
+
+vector<vector<size_t>> AbstractionBuilder::Waves() const {
+  auto waves = vector<vector<size_t>>();
+  auto done = vector<bool>(stages.size(), false);
+  auto nofDone = 0UL;
+  while (nofDone < stages.size()) {
+    auto wave = vector<size_t>();
+    for (auto i = 0UL; i < stages.size(); i++) {
+      if (done[i])
+        continue;
+      auto ready = true;
+      for (auto &dependency : stages[i].dependencies)
+        ready = ready && done[StageIndex(dependency)];
+      if (ready)
+        wave.push_back(i);
+    }
+    if (wave.empty())
+      throw invalid_argument("Abstraction stages have a dependency cycle");
+    for (auto i : wave)
+      done[i] = true;
+    nofDone += wave.size();
+    waves.push_back(wave);
+  }
+  return waves;
+}
+
+// a dependency contributes the checksums of its outputs as recorded when it
+// was built, or its parameters and inputs if it has no outputs
+uint32_t AbstractionBuilder::InputsChecksum(size_t stage) const {
+  auto hash = utils::Checksum("");
+  for (auto &name : stages[stage].dependencies) {
+    auto dependency = StageIndex(name);
+    hash = utils::Checksum(name, hash);
+    if (stages[dependency].outputs.empty()) {
+      hash = utils::Checksum(stages[dependency].parameters, hash);
+      auto inputs = InputsChecksum(dependency);
+      hash = utils::Checksum(string_view((const char *)&inputs, sizeof(inputs)),
+                             hash);
+      continue;
+    }
+    auto entry = manifest.find(name);
+    if (entry == manifest.end())
+      continue;
+    for (auto &output : entry->second.outputs)
+      hash = utils::Checksum(
+          string_view((const char *)&output.checksum, sizeof(output.checksum)),
+          hash);
+  }
+  return hash;
+}
+
+bool AbstractionBuilder::IsUpToDate(size_t stage, bool verify) const {
+  auto &definition = stages[stage];
+  auto entry = manifest.find(definition.name);
+  if (entry == manifest.end() ||
+      entry->second.parameters != utils::Checksum(definition.parameters) ||
+      entry->second.inputs != InputsChecksum(stage) ||
+      entry->second.outputs.size() != definition.outputs.size())
+    return false;
+  for (auto i = 0UL; i < definition.outputs.size(); i++) {
+    auto &output = entry->second.outputs[i];
+    if (output.filename != definition.outputs[i] ||
+        !utils::FileExists(output.filename) ||
+        filesystem::file_size(output.filename) != output.size ||
+        OutputChecksum(output.filename, verify) != output.checksum)
+      return false;
+  }
+  return true;
+}
+
+void AbstractionBuilder::Run(size_t stage) {
+  auto &definition = stages[stage];
+  RunMemoryDependencies(stage);
+
+  cout << "Building stage " << definition.name << endl;
+  // stale outputs would otherwise be loaded instead of rebuilt
+  for (auto &output : definition.outputs)
+    remove(output.c_str());
+  definition.build();
+
+  auto entry = ManifestEntry();
+  entry.parameters = utils::Checksum(definition.parameters);
+  entry.description = definition.parameters;
+  for (auto &output : definition.outputs) {
+    if (!utils::FileExists(output))
+      throw runtime_error("Stage " + definition.name + " did not write " +
+                          output);
+    entry.outputs.push_back(
+        {output, OutputChecksum(output, true), filesystem::file_size(output)});
+  }
+
+  lock_guard<mutex> lock(manifestMutex);
+  entry.inputs = InputsChecksum(stage);
+  manifest[definition.name] = entry;
+  SaveManifest();
+}
+
+void AbstractionBuilder::RunMemoryDependencies(size_t stage) {
+  for (auto &name : stages[stage].dependencies) {
+    auto dependency = StageIndex(name);
+    if (stages[dependency].outputs.size())
+      continue;
+    call_once(memoryStagesBuilt[dependency], [this, dependency] {
+      RunMemoryDependencies(dependency);
+      cout << "Building stage " << stages[dependency].name << endl;
+      stages[dependency].build();
+    });
+  }
+}
+} // namespace poker
@@ -6,70 +6,66 @@ using namespace indicators;
 
 namespace poker {
 // mapping each canonical flop hand (2+3 cards) to a cluster
-vector<int> EMDTable::flopIndices;
+utils::ArtifactView<EMDTable::FlopBucket> EMDTable::flopIndices;
 // mapping each canonical turn hand (2+4 cards) to a cluster
-vector<int> EMDTable::turnIndices;
+utils::ArtifactView<EMDTable::TurnBucket> EMDTable::turnIndices;
 
-vector<vector<float>> EMDTable::histogramsFlop;
-vector<vector<float>> EMDTable::histogramsTurn;
+utils::Matrix<float> EMDTable::histogramsFlop;
 
 const string EMDTable::filenameEMDTurnTable = "EMDTurnTable.bin";
 const string EMDTable::filenameEMDFlopTable = "EMDFlopTable.bin";
-const string EMDTable::filenameEMDFlopHistogram = "EMDFlopHistogram.bin";
-const string EMDTable::filenameEMDTurnHistogram = "EMDTurnHistogram.bin";
+// prefixes of the histogram chunk files
+const string EMDTable::filenameEMDFlopHistogram = "EMDFlopHistogram";
+const string EMDTable::filenameEMDTurnHistogram = "EMDTurnHistogram";
+// snapshots of the clustering in progress
+const string EMDTable::filenameEMDFlopKmeans = "EMDFlopKmeans.bin";
+const string EMDTable::filenameEMDTurnKmeans = "EMDTurnKmeans.bin";
+
+// histograms are generated chunk by chunk, so an interrupted build continues
+// with the first chunk missing on disk
+void EMDTable::BuildTurnClusters() {
+  OCHSTable::Load();
+  GenerateTurnHistograms();
+  ClusterTurn();
+}
 
-void EMDTable::Init() {
-  LoadFromFile();
-  SaveToFile();
+void EMDTable::BuildFlopClusters() {
+  if (!BucketTable<TurnBucket>::Exists(filenameEMDTurnTable))
+    throw runtime_error(filenameEMDTurnTable + " is missing");
+  BucketTable<TurnBucket>::Load(turnIndices, filenameEMDTurnTable,
+                                Global::nofTurnBuckets);
+  GenerateFlopHistograms();
+  ClusterFlop();
+}
 
-  if (turnIndices.size() == 0) {
-    if (histogramsTurn.size() == 0) {
-      GenerateTurnHistograms();
-      SaveToFile();
-    }
-    ClusterTurn();
-    SaveToFile();
-    GenerateFlopHistograms();
-    SaveToFile();
-    ClusterFlop();
-    SaveToFile();
-  } else if (flopIndices.size() == 0) {
-    if (histogramsFlop.size() == 0) {
-      GenerateFlopHistograms();
-      SaveToFile();
-    }
-    ClusterFlop();
-    SaveToFile();
-  }
+void EMDTable::Load(bool verify) {
+  LoadFromFile(verify);
+  if (!turnIndices.size() || !flopIndices.size())
+    throw runtime_error("EMD tables are missing, run `abstraction build`");
 }
-void EMDTable::SaveToFile() {
-  if (flopIndices.size() && !utils::FileExists(filenameEMDFlopTable)) {
-    utils::SaveToFile(flopIndices, filenameEMDFlopTable);
-  }
-  if (turnIndices.size() && !utils::FileExists(filenameEMDTurnTable)) {
-    utils::SaveToFile(turnIndices, filenameEMDTurnTable);
-  }
-  if (histogramsFlop.size() && !utils::FileExists(filenameEMDFlopHistogram)) {
-    utils::SaveToFile(histogramsFlop, filenameEMDFlopHistogram);
-  }
-  if (histogramsTurn.size() && !utils::FileExists(filenameEMDTurnHistogram)) {
-    utils::SaveToFile(histogramsTurn, filenameEMDTurnHistogram);
-  }
+
+void EMDTable::LoadFromFile(bool verify) {
+  BucketTable<TurnBucket>::Load(turnIndices, filenameEMDTurnTable,
+                                Global::nofTurnBuckets, verify);
+  BucketTable<FlopBucket>::Load(flopIndices, filenameEMDFlopTable,
+                                Global::nofFlopBuckets, verify);
 }
 
-void EMDTable::LoadFromFile() {
-  if (utils::FileExists(filenameEMDTurnTable)) {
-    utils::LoadFromFile(turnIndices, filenameEMDTurnTable);
-  }
-  if (utils::FileExists(filenameEMDFlopTable)) {
-    utils::LoadFromFile(flopIndices, filenameEMDFlopTable);
-  }
-  if (flopIndices.size() == 0 && utils::FileExists(filenameEMDFlopHistogram)) {
-    utils::LoadFromFile(histogramsFlop, filenameEMDFlopHistogram);
-  }
-  if (turnIndices.size() == 0 && utils::FileExists(filenameEMDTurnHistogram)) {
-    utils::LoadFromFile(histogramsTurn, filenameEMDTurnHistogram);
-  }
+utils::ChunkedMatrix EMDTable::TurnHistogramChunks() {
+  // chunks counting other river clusters are stale. A turn hand reaches at
+  // most 46 river buckets, so the histograms are kept sparse.
+  return utils::ChunkedMatrix(
+      filenameEMDTurnHistogram, Global::indexer_2_4.roundSize[1],
+      Global::nofRiverBuckets,
+      BucketTable<OCHSTable::RiverBucket>::Checksum(OCHSTable::riverIndices),
+      0, true);
+}
+
+utils::ChunkedMatrix EMDTable::FlopHistogramChunks() {
+  return utils::ChunkedMatrix(filenameEMDFlopHistogram,
+                              Global::indexer_2_3.roundSize[1],
+                              Global::nofTurnBuckets,
+                              BucketTable<TurnBucket>::Checksum(turnIndices));
 }
 
 void EMDTable::GenerateTurnHistograms() {
@@ -78,32 +74,10 @@ void EMDTable::GenerateTurnHistograms() {
             << endl;
   chrono::steady_clock::time_point start = chrono::steady_clock::now();
 
-  histogramsTurn = vector<vector<float>>(
-      Global::indexer_2_4.roundSize[1], vector<float>(Global::nofRiverBuckets));
-
-  auto threadFunc = [&](int /*threadIdx*/, int itemIdx) {
-    auto cards = vector<int>(6);
-
-    Global::indexer_2_4.Unindex(Global::indexer_2_4.rounds - 1, itemIdx, cards);
-
-    ulong shared = (1uL << cards[2]) + (1uL << cards[3]) + (1uL << cards[4]) +
-                   (1uL << cards[5]);
-    ulong handTurn = (1uL << cards[0]) + (1uL << cards[1]) + shared;
-
-    for (auto cardRiver = 0; cardRiver < Global::CARDS; cardRiver++) {
-      if ((1uL << cardRiver) & handTurn)
-        continue;
-
-      cards.push_back(cardRiver);
-      auto riverHandCanonicalIndex = Global::indexer_2_5.IndexLastRound(cards);
-      auto riverClusterIndex = OCHSTable::riverIndices[riverHandCanonicalIndex];
-      histogramsTurn[itemIdx][riverClusterIndex]++;
-
-      cards.pop_back();
-    }
-  };
-
-  utils::parallelise(histogramsTurn.size(), threadFunc);
+  TurnHistogramChunks().Generate([](long begin,
+                                    utils::Matrix<float> &histograms) {
+    GenerateTurnHistograms(begin, histograms);
+  });
 
   chrono::steady_clock::time_point end = chrono::steady_clock::now();
   auto elapsed =
@@ -112,36 +86,51 @@ void EMDTable::GenerateTurnHistograms() {
             << endl;
 }
 
+void EMDTable::GenerateTurnHistograms(long begin,
+                                      utils::Matrix<float> &histograms) {
+  // each range of rows walks its hands in index order
+  oneapi::tbb::parallel_for(
+      oneapi::tbb::blocked_range<long>(0, histograms.Rows()),
+      [&](const oneapi::tbb::blocked_range<long> &range) {
+        auto hands = HandEnumerator(Global::indexer_2_4,
+                                    Global::indexer_2_4.rounds - 1,
+                                    begin + range.begin());
+        for (auto row = range.begin(); row < range.end();
+             row++, hands.Next()) {
+          auto &cards = hands.Cards();
+          ulong shared = (1uL << cards[2]) + (1uL << cards[3]) +
+                         (1uL << cards[4]) + (1uL << cards[5]);
+          ulong handTurn = (1uL << cards[0]) + (1uL << cards[1]) + shared;
+
+          auto turn = StreetIndexer(cards[0], cards[1]);
+          for (auto i = 2; i < 6; i++)
+            turn.Deal(cards[i]);
+
+          for (auto cardRiver = 0; cardRiver < Global::CARDS; cardRiver++) {
+            if ((1uL << cardRiver) & handTurn)
+              continue;
+
+            auto river = turn;
+            river.Deal(cardRiver);
+            auto riverHandCanonicalIndex = river.Index(Global::indexer_2_5);
+            auto riverClusterIndex =
+                OCHSTable::riverIndices[riverHandCanonicalIndex];
+            histograms[row][riverClusterIndex]++;
+          }
+        }
+      });
+}
+
 void EMDTable::GenerateFlopHistograms() {
   std::cout << "Generating histograms for " << Global::indexer_2_3.roundSize[1]
             << " flop hands of length " << Global::nofTurnBuckets << " each..."
             << endl;
   chrono::steady_clock::time_point start = chrono::steady_clock::now();
 
-  histogramsFlop = vector<vector<float>>(Global::indexer_2_3.roundSize[1],
-                                         vector<float>(Global::nofTurnBuckets));
-
-  auto threadFunc = [&](int /*threadIdx*/, int itemIdx) {
-    auto cards = vector<int>(5);
-
-    Global::indexer_2_3.Unindex(Global::indexer_2_3.rounds - 1, itemIdx, cards);
-
-    ulong shared = (1uL << cards[2]) + (1uL << cards[3]) + (1uL << cards[4]);
-    ulong handFlop = (1uL << cards[0]) + (1uL << cards[1]) + shared;
-
-    for (auto cardTurn = 0; cardTurn < Global::CARDS; cardTurn++) {
-      if ((1uL << cardTurn) & handFlop)
-        continue;
-
-      cards.push_back(cardTurn);
-      auto turnHandCanonicalIndex = Global::indexer_2_4.IndexLastRound(cards);
-      auto turnClusterIndex = EMDTable::turnIndices[turnHandCanonicalIndex];
-      histogramsFlop[itemIdx][turnClusterIndex]++;
-
-      cards.pop_back();
-    }
-  };
-  utils::parallelise(histogramsFlop.size(), threadFunc);
+  FlopHistogramChunks().Generate([](long begin,
+                                    utils::Matrix<float> &histograms) {
+    GenerateFlopHistograms(begin, histograms);
+  });
 
   chrono::steady_clock::time_point end = chrono::steady_clock::now();
   auto elapsed =
@@ -150,12 +139,54 @@ void EMDTable::GenerateFlopHistograms() {
        << endl;
 }
 
+void EMDTable::GenerateFlopHistograms(long begin,
+                                      utils::Matrix<float> &histograms) {
+  // each range of rows walks its hands in index order
+  oneapi::tbb::parallel_for(
+      oneapi::tbb::blocked_range<long>(0, histograms.Rows()),
+      [&](const oneapi::tbb::blocked_range<long> &range) {
+        auto hands = HandEnumerator(Global::indexer_2_3,
+                                    Global::indexer_2_3.rounds - 1,
+                                    begin + range.begin());
+        for (auto row = range.begin(); row < range.end();
+             row++, hands.Next()) {
+          auto &cards = hands.Cards();
+          ulong shared =
+              (1uL << cards[2]) + (1uL << cards[3]) + (1uL << cards[4]);
+          ulong handFlop = (1uL << cards[0]) + (1uL << cards[1]) + shared;
+
+          auto flop = StreetIndexer(cards[0], cards[1]);
+          for (auto i = 2; i < 5; i++)
+            flop.Deal(cards[i]);
+
+          for (auto cardTurn = 0; cardTurn < Global::CARDS; cardTurn++) {
+            if ((1uL << cardTurn) & handFlop)
+              continue;
+
+            auto turn = flop;
+            turn.Deal(cardTurn);
+            auto turnHandCanonicalIndex = turn.Index(Global::indexer_2_4);
+            auto turnClusterIndex =
+                EMDTable::turnIndices[turnHandCanonicalIndex];
+            histograms[row][turnClusterIndex]++;
+          }
+        }
+      });
+}
+
 void EMDTable::ClusterTurn() {
   chrono::steady_clock::time_point start = chrono::steady_clock::now();
-  Kmeans kmeans = Kmeans();
-  auto indices = vector<int>();
-  turnIndices =
-      kmeans.ClusterEMD(histogramsTurn, Global::nofTurnBuckets, 1, indices);
+  Kmeans kmeans = Kmeans(filenameEMDTurnKmeans);
+  // too many rows to keep in memory for full iterations
+  auto options = MiniBatchOptions();
+  BucketTable<TurnBucket>::Save(
+      BucketTable<TurnBucket>::Narrow(kmeans.ClusterEMD(
+          TurnHistogramChunks(), Global::nofTurnBuckets, options)),
+      filenameEMDTurnTable, Global::nofTurnBuckets);
+  BucketTable<TurnBucket>::Load(turnIndices, filenameEMDTurnTable,
+                                Global::nofTurnBuckets);
+  // the clustering snapshot is no longer needed once its table is saved
+  remove(filenameEMDTurnKmeans.c_str());
 
   chrono::steady_clock::time_point end = chrono::steady_clock::now();
   auto elapsed =
@@ -186,10 +217,17 @@ void EMDTable::ClusterTurn() {
 
 void EMDTable::ClusterFlop() {
   chrono::steady_clock::time_point start = chrono::steady_clock::now();
-  Kmeans kmeans = Kmeans();
+  Kmeans kmeans = Kmeans(filenameEMDFlopKmeans);
   auto indices = vector<int>();
-  flopIndices =
-      kmeans.ClusterEMD(histogramsFlop, Global::nofFlopBuckets, 1, indices);
+  histogramsFlop = FlopHistogramChunks().ReadAll();
+  BucketTable<FlopBucket>::Save(
+      BucketTable<FlopBucket>::Narrow(kmeans.ClusterEMD(
+          histogramsFlop, Global::nofFlopBuckets, 1, indices)),
+      filenameEMDFlopTable, Global::nofFlopBuckets);
+  BucketTable<FlopBucket>::Load(flopIndices, filenameEMDFlopTable,
+                                Global::nofFlopBuckets);
+  remove(filenameEMDFlopKmeans.c_str());
+  histogramsFlop = utils::Matrix<float>();
 
   chrono::steady_clock::time_point end = chrono::steady_clock::now();
   auto elapsed =
@@ -1,288 +1,283 @@
 #include "tables/evaluator.h"
+#include "abstraction/global.h"
 
-namespace poker {
-void Evaluator::Initialise() {
-  string fileName = "HandValueTable.bin";
-  double loadFactor = 6.0;
-
-  if (loaded)
-    return;
-  if (monteCarloMap.size())
-    return;
-
-  bool fiveCards = true;
-  bool sixCards = true;
-  bool sevenCards = true;
+#include <algorithm>
+#include <functional>
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
 
-  chrono::steady_clock::time_point start = chrono::steady_clock::now();
-
-  // Load hand rank table or create one if no file was given
-  if (fileName.size() && access(fileName.c_str(), F_OK) != -1) {
-    std::cout << "Loading table from " << fileName << endl;
-    LoadFromFile(fileName);
-  } else {
-    int minHashMapSize = (fiveCards ? 2598960 : 0) + (sixCards ? 20358520 : 0) +
-                         (sevenCards ? 133784560 : 0);
-    handRankMap =
-        unordered_map<ulong, ulong>((uint)(minHashMapSize * loadFactor));
-    if (fiveCards) {
-      GenerateFiveCardTable();
-      SaveToFile(fileName);
-    }
-    if (sixCards) {
-      std::cout << "Generating new six card lookup table (52C6 = 20,358,520)"
-                << endl;
-      GenerateHandValueTable(6);
-      SaveToFile(fileName);
+namespace poker {
+namespace {
+typedef array<int, Global::RANKS> RankCounts;
+
+// calls f with every way to place cards into ranks, at most 4 per rank
+void ForEachRankMultiset(int cards, const function<void(RankCounts &)> &f) {
+  RankCounts counts{};
+  function<void(int, int)> place = [&](int rank, int remaining) {
+    if (rank < 0) {
+      if (remaining == 0)
+        f(counts);
+      return;
     }
-    if (sevenCards) {
-      std::cout << "Generating new seven card lookup table (52C7 = 133,784,560)"
-                << endl;
-      GenerateHandValueTable(7);
-      SaveToFile(fileName);
+    for (auto count = 0; count <= min(remaining, Global::SUITS); count++) {
+      counts[rank] = count;
+      place(rank - 1, remaining - count);
     }
-
-    // Console.WriteLine("Running monte carlo simulation");
-    // GenerateMonteCarloMap(100000);
-    std::cout << "Writing table to disk" << endl;
-    SaveToFile(fileName);
-  }
-
-  chrono::steady_clock::time_point end = chrono::steady_clock::now();
-
-  auto elapsed =
-      chrono::duration_cast<std::chrono::seconds>(end - start).count();
-  std::cout << "Time taken to generate lookup table: " << elapsed << "[s]"
-            << endl;
-  loaded = true;
-}
-
-int Evaluator::Evaluate(ulong bitmap) {
-  // Check if 2-card monte carlo map has an evaluation for this hand
-  // if (monteCarloMap.ContainsKey(bitmap)) return (int)monteCarloMap[bitmap];
-
-  // Otherwise return the real evaluation
-  return (int)handRankMap[bitmap];
+    counts[rank] = 0;
+  };
+  place(Global::RANKS - 1, cards);
 }
 
-void Evaluator::SaveToFile(string &fileName) {
-  ofstream file(fileName);
-  boost::archive::binary_oarchive archive(file);
-  archive << handRankMap;
+// a hand of the given ranks without 5 cards of the same suit
+ulong NonFlushBitmap(const RankCounts &counts) {
+  ulong bitmap = 0ul;
+  int card = 0;
+  for (auto rank = 0; rank < Global::RANKS; rank++)
+    for (auto i = 0; i < counts[rank]; i++, card++)
+      bitmap |= 1ul << (4 * rank + card % Global::SUITS);
+  return bitmap;
 }
 
-void Evaluator::LoadFromFile(string &fileName) {
-  ifstream file(fileName);
-  boost::archive::binary_iarchive archive(file);
-  archive >> handRankMap;
+// a hand of suit 0 cards with the ranks set in mask
+ulong FlushBitmap(int mask) {
+  ulong bitmap = 0ul;
+  for (auto rank = 0; rank < Global::RANKS; rank++)
+    if (mask & (1 << rank))
+      bitmap |= 1ul << (4 * rank);
+  return bitmap;
 }
+} // namespace
 
-void Evaluator::GenerateFiveCardTable() {
-  vector<int> combo(Global::CARDS);
-  for (auto i = 0; i < Global::CARDS; i++)
-    combo[i] = i;
+Evaluator::Evaluator() { Initialise(); }
 
-  int comboSize = 5;
-  auto handBitmaps = vector<ulong>();
-  do {
-    ulong bitmap = 0ul;
-    for (auto i = 0; i < comboSize; i++)
-      bitmap |= 1ul << combo[i];
-    handBitmaps.push_back(bitmap);
-  } while (
-      next_combination(combo.begin(), combo.begin() + comboSize, combo.end()));
+void Evaluator::Initialise() { call_once(generated, GenerateTables); }
 
-  // Calculate hand strength of each hand
-  auto handStrengths = unordered_map<ulong, HandStrength>();
-  std::cout << "Calculating hand strength (" << handBitmaps.size() << ")"
-            << endl;
-
-  for (auto bitmap : handBitmaps) {
-    Hand hand = Hand(bitmap);
-    handStrengths[bitmap] = hand.GetStrength();
+int Evaluator::Evaluate(ulong bitmap) {
+  // only one suit can hold 5 of at most 7 cards
+  for (auto suit = 0; suit < Global::SUITS; suit++) {
+    if (__builtin_popcountl(bitmap & (SUIT_MASK << suit)) >= 5)
+      return flushTable[SuitRanks(bitmap, suit)];
   }
+  return rankTable[RankHash(bitmap)];
+}
 
-  // Generate a list of all unique hand strengths
-  auto uniqueHandStrengths = vector<HandStrength>();
-  std::cout << "Generating equivalence classes" << endl;
-
-  for (auto [bitmap, strength] : handStrengths) {
-    auto insert_it = lower_bound(uniqueHandStrengths.begin(),
-                                 uniqueHandStrengths.end(), strength);
-    if (insert_it == uniqueHandStrengths.end() || *insert_it != strength) {
-      uniqueHandStrengths.insert(insert_it, strength);
+void Evaluator::EvaluateBatch(ulong board, span<const ulong> holeCards,
+                              span<int> values) {
+  size_t i = 0;
+#ifdef __x86_64__
+  // the gather path is compiled for AVX2 even if the rest of the build is not
+  static const bool avx2 = __builtin_cpu_supports("avx2");
+  if (avx2)
+    i = EvaluateRankBatch(board, holeCards, values);
+#endif
+  for (; i < holeCards.size(); i++)
+    values[i] = rankTable[RankHash(board | holeCards[i])];
+
+  // two hole cards can only complete a flush in a suit the board holds 3 of
+  for (auto suit = 0; suit < SUITS; suit++) {
+    ulong suitMask = SUIT_MASK << suit;
+    if (__builtin_popcountl(board & suitMask) < 3)
+      continue;
+    for (i = 0; i < holeCards.size(); i++) {
+      ulong hand = board | holeCards[i];
+      if (__builtin_popcountl(hand & suitMask) >= 5)
+        values[i] = flushTable[SuitRanks(hand, suit)];
     }
   }
+}
 
-  std::cout << uniqueHandStrengths.size() << " unique hand strengths" << endl;
-
-  // Create a map of hand bitmaps to hand strength indices
-  std::cout << "Generating new five card lookup table (2,598,960)" << endl;
-
-  for (ulong bitmap : handBitmaps) {
-    Hand hand = Hand(bitmap);
-    HandStrength strength = hand.GetStrength();
-    auto equivalence = lower_bound(uniqueHandStrengths.begin(),
-                                   uniqueHandStrengths.end(), strength);
-    if (equivalence == uniqueHandStrengths.end() ||
-        equivalence->Compare(strength) != 0) {
-      throw invalid_argument(hand.ToString() + " hand not found");
-    } else {
-      handRankMap[bitmap] = (ulong)(equivalence - uniqueHandStrengths.begin());
+#ifdef __x86_64__
+__attribute__((target("avx2"))) size_t
+Evaluator::EvaluateRankBatch(ulong board, span<const ulong> holeCards,
+                                    span<int> values) {
+  const __m256i boards = _mm256_set1_epi64x(board);
+  const __m256i nibble = _mm256_set1_epi64x(0xF);
+  const __m256i countStride = _mm256_set1_epi64x(RANKS * (MAX_CARDS + 1));
+  const int *offsets = &rankOffsets[0][0][0];
+
+  size_t i = 0;
+  for (; i + 4 <= holeCards.size(); i += 4) {
+    __m256i hands = _mm256_or_si256(
+        boards, _mm256_loadu_si256((const __m256i *)&holeCards[i]));
+
+    // same as NibbleCounts and RankHash, 4 hands at a time
+    __m256i x = _mm256_sub_epi64(
+        hands, _mm256_and_si256(_mm256_srli_epi64(hands, 1),
+                                _mm256_set1_epi64x(0x5555555555555555ul)));
+    __m256i pairs = _mm256_set1_epi64x(0x3333333333333333ul);
+    __m256i counts =
+        _mm256_add_epi64(_mm256_and_si256(x, pairs),
+                         _mm256_and_si256(_mm256_srli_epi64(x, 2), pairs));
+    __m256i placed = _mm256_add_epi64(counts, _mm256_slli_epi64(counts, 4));
+    placed = _mm256_add_epi64(placed, _mm256_slli_epi64(placed, 8));
+    placed = _mm256_add_epi64(placed, _mm256_slli_epi64(placed, 16));
+    placed = _mm256_add_epi64(placed, _mm256_slli_epi64(placed, 32));
+
+    __m128i hash = _mm256_i64gather_epi32(
+        rankTableStart.data(),
+        _mm256_and_si256(_mm256_srli_epi64(placed, 4 * (RANKS - 1)), nibble),
+        4);
+    for (auto rank = 0; rank < RANKS; rank++) {
+      __m256i index = _mm256_add_epi64(
+          _mm256_mul_epu32(_mm256_and_si256(counts, nibble), countStride),
+          _mm256_add_epi64(_mm256_set1_epi64x(rank * (MAX_CARDS + 1)),
+                           _mm256_and_si256(placed, nibble)));
+      hash = _mm_add_epi32(hash, _mm256_i64gather_epi32(offsets, index, 4));
+      counts = _mm256_srli_epi64(counts, 4);
+      placed = _mm256_srli_epi64(placed, 4);
     }
-    // std::cout << handRankMap[bitmap] << " " << hand.ToString() << " " <<
-    // strength << std::endl;
+
+    // 32-bit gathers of the uint16_t table, rankTable is padded for the last
+    __m128i ranks = _mm_and_si128(
+        _mm_i32gather_epi32((const int *)rankTable.data(), hash, 2),
+        _mm_set1_epi32(0xFFFF));
+    _mm_storeu_si128((__m128i *)&values[i], ranks);
   }
-  std::cout << "handRankMap size: " << handRankMap.size() << endl;
+  return i;
 }
-
-void Evaluator::GenerateHandValueTable(int comboSize) {
-  long totalCombos; // nCr(52, comboSize)
-  switch (comboSize) {
-  case 5:
-    totalCombos = 2598960;
-    break;
-  case 6:
-    totalCombos = 20358520;
-    break;
-  case 7:
-    totalCombos = 133784560;
-    break;
-  default:
-    throw invalid_argument(
-        "Unsupported combo size for hand value table generation.");
+#endif
+
+BoardState::BoardState(ulong board)
+    : board{board}, flushSuit{-1}, boardSuitRanks{0}, boardSuitCards{0},
+      pairValues{} {
+  call_once(Evaluator::generated, Evaluator::GenerateTables);
+
+  ulong boardCounts = Evaluator::NibbleCounts(board);
+  for (auto low = 0; low < Evaluator::RANKS; low++) {
+    for (auto high = low; high < Evaluator::RANKS; high++) {
+      ulong counts = boardCounts + (1ul << (4 * low)) + (1ul << (4 * high));
+      // no hole cards of a rank the board already holds all suits of
+      if (((counts >> (4 * low)) & 0xF) > (ulong)Evaluator::SUITS ||
+          ((counts >> (4 * high)) & 0xF) > (ulong)Evaluator::SUITS)
+        continue;
+      pairValues[low * Evaluator::RANKS + high] =
+          Evaluator::rankTable[Evaluator::CountsHash(counts)];
+    }
   }
 
-  vector<int> combo(Global::CARDS);
-  for (auto i = 0; i < Global::CARDS; i++)
-    combo[i] = i;
-
-  using namespace indicators;
-  indicators::show_console_cursor(false);
-  BlockProgressBar bar{
-      option::BarWidth{80},
-      option::Start{"["},
-      option::End{"]"},
-      option::ForegroundColor{Color::white},
-      option::FontStyles{std::vector<FontStyle>{FontStyle::bold}},
-      option::ShowElapsedTime{true},
-      option::ShowRemainingTime{true},
-      option::MaxProgress{totalCombos}};
-
-  long iter = 0;
-  do {
-    int subsetSize = comboSize - 1;
-    auto subset = vector<int>(combo.begin(), combo.begin() + comboSize);
-    auto subsetValues = vector<ulong>();
-
-    do {
-      ulong subsetBitmap = 0ul;
-      for (auto i = 0; i < subsetSize; i++) {
-        int card = subset[i];
-        subsetBitmap |= 1ul << card;
-      }
-      subsetValues.push_back(handRankMap[subsetBitmap]);
-    } while (next_combination(subset.begin(), subset.begin() + subsetSize,
-                              subset.end()));
-
-    ulong bitmap = 0ul;
-    for (auto i = 0; i < comboSize; i++)
-      bitmap |= 1ul << combo[i];
-
-    handRankMap[bitmap] =
-        *max_element(subsetValues.begin(), subsetValues.end());
-
-    iter++;
-    if (iter % 10000 == 0) {
-      bar.set_progress(iter);
-      bar.set_option(option::PostfixText{std::to_string(iter) + "/" +
-                                         std::to_string(totalCombos)});
+  for (auto suit = 0; suit < Evaluator::SUITS; suit++) {
+    int ranks = Evaluator::SuitRanks(board, suit);
+    if (__builtin_popcount(ranks) >= 3) {
+      flushSuit = suit;
+      boardSuitRanks = ranks;
+      boardSuitCards = __builtin_popcount(ranks);
     }
-  } while (
-      next_combination(combo.begin(), combo.begin() + comboSize, combo.end()));
-  bar.set_progress(iter);
-  indicators::show_console_cursor(true);
-  std::cout << "handRankMap size: " << handRankMap.size() << endl;
+  }
 }
 
-// Deprecated
-void Evaluator::GenerateMonteCarloMap(int iterations) {
-  monteCarloMap = unordered_map<ulong, ulong>();
-
-  vector<int> combo(Global::CARDS);
-  for (auto i = 0; i < Global::CARDS; i++) {
-    combo[i] = i;
+vector<BoardState::Completion> BoardState::SortedCompletions() const {
+  int remaining = Global::CARDS - __builtin_popcountl(board);
+  auto completions = vector<Completion>();
+  completions.reserve(remaining * (remaining - 1) / 2);
+  for (auto card1 = 0; card1 < Global::CARDS; card1++) {
+    if (board & (1ul << card1))
+      continue;
+    for (auto card2 = card1 + 1; card2 < Global::CARDS; card2++) {
+      ulong holeCards = (1ul << card1) | (1ul << card2);
+      if (!(board & holeCards))
+        completions.push_back({holeCards, Evaluate(holeCards)});
+    }
   }
-  int count = 0;
-  int comboSize = 2;
-
-  do {
-    std::cout << count++ << '\r' << endl;
-
-    ulong bitmap = 0ul;
-    for (auto i = 0; i < comboSize; i++)
-      bitmap |= 1ul << combo[i];
-
-    Hand hand = Hand(bitmap);
-    Deck deck = Deck(bitmap);
+  sort(completions.begin(), completions.end(),
+       [](auto &a, auto &b) { return a.value < b.value; });
+  return completions;
+}
 
-    ulong evaluationSum = 0;
-    for (auto i = 0; i < iterations; i++) {
-      if (deck.NumRemainingCards() < 13)
-        deck.Shuffle();
-      evaluationSum +=
-          handRankMap[bitmap |
-                      deck.Draw(3)]; // TODO: this uses an old draw method
-    }
+void Evaluator::GenerateRankOffsets() {
+  // ways[n][k]: number of ways to place k cards into n ranks
+  array<array<int, MAX_CARDS + 1>, Global::RANKS + 1> ways{};
+  ways[0][0] = 1;
+  for (auto n = 1; n <= Global::RANKS; n++)
+    for (auto k = 0; k <= MAX_CARDS; k++)
+      for (auto count = 0; count <= min(k, SUITS); count++)
+        ways[n][k] += ways[n - 1][k - count];
+
+  // multisets are ordered by the count of the highest rank first, so every
+  // smaller count of a rank skips all placements of the remaining cards below
+  for (auto count = 0; count <= SUITS; count++)
+    for (auto rank = 0; rank < Global::RANKS; rank++)
+      for (auto k = 0; k <= MAX_CARDS; k++) {
+        rankOffsets[count][rank][k] = 0;
+        for (auto smaller = 0; smaller < count && smaller <= k; smaller++)
+          rankOffsets[count][rank][k] += ways[rank][k - smaller];
+      }
 
-    monteCarloMap[bitmap] = evaluationSum / (ulong)iterations;
-  } while (
-      next_combination(combo.begin(), combo.begin() + comboSize, combo.end()));
+  rankTableStart[0] = 0;
+  for (auto k = 0; k <= MAX_CARDS; k++)
+    rankTableStart[k + 1] = rankTableStart[k] + ways[Global::RANKS][k];
+}
 
-  for (auto [k, v] : monteCarloMap) {
-    Hand hand = Hand(k);
-    string end = "\t";
-    hand.PrintColoredCards(end);
-    std::cout << v << endl;
-    handRankMap[k] = v;
+int Evaluator::RankHash(const RankCounts &counts) {
+  int cards = 0;
+  for (auto count : counts)
+    cards += count;
+  int hash = rankTableStart[cards];
+  for (auto rank = Global::RANKS - 1; rank >= 0; rank--) {
+    hash += rankOffsets[counts[rank]][rank][cards];
+    cards -= counts[rank];
   }
+  return hash;
 }
 
-template <typename Iterator>
-inline bool next_combination(const Iterator first, Iterator k,
-                             const Iterator last) {
-  /* Credits: Thomas Draper */
-  // http://stackoverflow.com/a/5097100/8747
-  if ((first == last) || (first == k) || (last == k))
-    return false;
-  Iterator itr1 = first;
-  Iterator itr2 = last;
-  ++itr1;
-  if (last == itr1)
-    return false;
-  itr1 = last;
-  --itr1;
-  itr1 = k;
-  --itr2;
-  while (first != itr1) {
-    if (*--itr1 < *itr2) {
-      Iterator j = k;
-      while (!(*itr1 < *j))
-        ++j;
-      std::iter_swap(itr1, j);
-      ++itr1;
-      ++j;
-      itr2 = k;
-      std::rotate(itr1, j, last);
-      while (last != j) {
-        ++j;
-        ++itr2;
+void Evaluator::GenerateTables() {
+  GenerateRankOffsets();
+  flushTable = vector<uint16_t>(1 << Global::RANKS);
+  // one spare entry so a 32-bit read of the last entry stays in bounds
+  rankTable = vector<uint16_t>(rankTableStart[MAX_CARDS + 1] + 1);
+
+  // equivalence classes are the sorted unique strengths of all 5-card hands
+  auto flushHands = vector<int>();
+  for (auto mask = 0; mask < (1 << Global::RANKS); mask++)
+    if (__builtin_popcount(mask) == 5)
+      flushHands.push_back(mask);
+  auto rankHands = vector<RankCounts>();
+  ForEachRankMultiset(5, [&](RankCounts &counts) { rankHands.push_back(counts); });
+
+  auto flushStrengths = vector<HandStrength>();
+  for (auto mask : flushHands)
+    flushStrengths.push_back(Hand(FlushBitmap(mask)).GetStrength());
+  auto rankStrengths = vector<HandStrength>();
+  for (auto &counts : rankHands)
+    rankStrengths.push_back(Hand(NonFlushBitmap(counts)).GetStrength());
+
+  auto uniqueStrengths = flushStrengths;
+  uniqueStrengths.insert(uniqueStrengths.end(), rankStrengths.begin(),
+                         rankStrengths.end());
+  sort(uniqueStrengths.begin(), uniqueStrengths.end());
+  uniqueStrengths.erase(unique(uniqueStrengths.begin(), uniqueStrengths.end()),
+                        uniqueStrengths.end());
+
+  auto equivalence = [&](const HandStrength &strength) {
+    return (uint16_t)(lower_bound(uniqueStrengths.begin(),
+                                  uniqueStrengths.end(), strength) -
+                      uniqueStrengths.begin());
+  };
+  for (auto i = 0UL; i < flushHands.size(); i++)
+    flushTable[flushHands[i]] = equivalence(flushStrengths[i]);
+  for (auto i = 0UL; i < rankHands.size(); i++)
+    rankTable[RankHash(rankHands[i])] = equivalence(rankStrengths[i]);
+
+  // larger hands take the best hand left after dropping any one card,
+  // submasks are smaller numbers so they are always done first
+  for (auto mask = 0; mask < (1 << Global::RANKS); mask++) {
+    if (__builtin_popcount(mask) <= 5)
+      continue;
+    for (auto rank = 0; rank < Global::RANKS; rank++)
+      if (mask & (1 << rank))
+        flushTable[mask] = max(flushTable[mask], flushTable[mask ^ (1 << rank)]);
+  }
+  for (auto cards = 6; cards <= MAX_CARDS; cards++) {
+    ForEachRankMultiset(cards, [&](RankCounts &counts) {
+      auto &value = rankTable[RankHash(counts)];
+      for (auto rank = 0; rank < Global::RANKS; rank++) {
+        if (!counts[rank])
+          continue;
+        counts[rank]--;
+        value = max(value, rankTable[RankHash(counts)]);
+        counts[rank]++;
       }
-      std::rotate(k, itr2, last);
-      return true;
-    }
+    });
   }
-  std::rotate(first, k, last);
-  return false;
 }
 } // namespace poker
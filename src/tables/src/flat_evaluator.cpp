@@ -0,0 +1,126 @@
+#include "tables/flat_evaluator.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <oneapi/tbb.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace poker {
+FlatEvaluator::FlatEvaluator(const string &filename)
+    : filename{filename}, table{nullptr}, mapping{nullptr}, mappingSize{0} {}
+
+FlatEvaluator::~FlatEvaluator() {
+  if (mapping)
+    munmap(mapping, mappingSize);
+}
+
+void FlatEvaluator::Initialise() {
+  Evaluator::Initialise();
+  if (table)
+    return;
+  if (access(filename.c_str(), F_OK) == -1) {
+    std::cout << "Generating flat seven card table (52C7 = 133,784,560)"
+              << endl;
+    Generate(filename);
+  }
+  Map();
+}
+
+int FlatEvaluator::Evaluate(ulong bitmap) {
+  if (__builtin_popcountl(bitmap) != HAND_CARDS)
+    return Evaluator::Evaluate(bitmap);
+  return table[ColexIndex(bitmap)];
+}
+
+void FlatEvaluator::EvaluateBatch(ulong board, span<const ulong> holeCards,
+                                  span<int> values) {
+  if (__builtin_popcountl(board) != HAND_CARDS - 2)
+    return Evaluator::EvaluateBatch(board, holeCards, values);
+  for (auto i = 0UL; i < holeCards.size(); i++)
+    values[i] = table[ColexIndex(board | holeCards[i])];
+}
+
+void FlatEvaluator::Generate(const string &filename) {
+  Evaluator evaluator;
+  // written under a temporary name so a partial file is never mapped
+  string partial = filename + ".tmp";
+  size_t size = HEADER_SIZE + ENTRIES * sizeof(uint16_t);
+  int fd = open(partial.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1 || ftruncate(fd, size) == -1)
+    throw runtime_error("Failed to write " + filename);
+  void *output = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (output == MAP_FAILED)
+    throw runtime_error("Failed to write " + filename);
+
+  memcpy(output, MAGIC.data(), MAGIC.size());
+  uint64_t entries = ENTRIES;
+  memcpy((char *)output + MAGIC.size(), &entries, sizeof(entries));
+  auto values = (uint16_t *)((char *)output + HEADER_SIZE);
+
+  // every range starts from its unranked first hand and steps through the
+  // following hands in colex order
+  oneapi::tbb::parallel_for(
+      oneapi::tbb::blocked_range<uint32_t>(0, ENTRIES, 1 << 16),
+      [&](const oneapi::tbb::blocked_range<uint32_t> &range) {
+        ulong bitmap = ColexBitmap(range.begin());
+        for (auto i = range.begin(); i < range.end(); i++) {
+          values[i] = (uint16_t)evaluator.Evaluate(bitmap);
+          ulong lowest = bitmap & -bitmap;
+          ulong carried = bitmap + lowest;
+          bitmap = carried | (((bitmap ^ carried) >> 2) / lowest);
+        }
+      });
+
+  bool written = msync(output, size, MS_SYNC) == 0;
+  munmap(output, size);
+  if (!written || rename(partial.c_str(), filename.c_str()))
+    throw runtime_error("Failed to write " + filename);
+}
+
+ulong FlatEvaluator::ColexBitmap(uint32_t index) {
+  ulong bitmap = 0ul;
+  int card = 52;
+  for (auto k = HAND_CARDS; k >= 1; k--) {
+    do
+      card--;
+    while (binomials[card][k] > index);
+    bitmap |= 1ul << card;
+    index -= binomials[card][k];
+  }
+  return bitmap;
+}
+
+void FlatEvaluator::Map() {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1)
+    throw runtime_error("Failed to open " + filename);
+  struct stat info;
+  fstat(fd, &info);
+  mappingSize = info.st_size;
+  if (mappingSize != HEADER_SIZE + ENTRIES * sizeof(uint16_t)) {
+    close(fd);
+    throw runtime_error(filename + " is not a flat seven card table");
+  }
+
+  mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    mapping = nullptr;
+    throw runtime_error("Failed to map " + filename);
+  }
+  if (string((const char *)mapping, MAGIC.size()) != MAGIC) {
+    munmap(mapping, mappingSize);
+    mapping = nullptr;
+    throw runtime_error(filename + " is not a flat seven card table");
+  }
+  // lookups are scattered, read ahead would only pull in unused pages
+  madvise(mapping, mappingSize, MADV_RANDOM);
+  table = (const uint16_t *)((const char *)mapping + HEADER_SIZE);
+}
+} // namespace poker
@@ -2,9 +2,13 @@
 
 namespace poker {
 HandIndexerState::HandIndexerState()
-    : round{0}, permutationIndex{0}, permutationMultiplier{1},
-      suitIndex(Global::SUITS, 0), suitMultiplier(Global::SUITS, 1),
-      usedRanks(Global::SUITS, 0) {}
+    : round{0}, permutationIndex{0}, permutationMultiplier{1}, suitIndex{},
+      suitMultiplier{1, 1, 1, 1}, usedRanks{} {}
+
+namespace {
+const int RANKS = Global::RANKS;
+const int SUITS = Global::SUITS;
+const int PERMUTATIONS = 24; // SUITS!
 
 /* nthUnset[i][j]
     where i is the rank combination in bitset format
@@ -13,83 +17,92 @@ HandIndexerState::HandIndexerState()
 
     e.g. nthUnset[1011][0] = 2
 */
-vector<vector<int>> HandIndexer::nthUnset(1 << Global::RANKS,
-                                          vector<int>(Global::RANKS));
-vector<vector<bool>> HandIndexer::equal(1 << (Global::SUITS - 1),
-                                        vector<bool>(Global::SUITS));
-vector<vector<int>> HandIndexer::nCrRanks(Global::RANKS + 1,
-                                          vector<int>(Global::RANKS + 1));
-vector<int> HandIndexer::rankSetToIndex(1 << Global::RANKS);
-vector<vector<int>> HandIndexer::indexToRankSet(Global::RANKS + 1,
-                                                vector<int>(1
-                                                            << Global::RANKS));
-vector<vector<long>> HandIndexer::nCrGroups(MAX_GROUP_INDEX,
-                                            vector<long>(Global::SUITS + 1));
-vector<vector<int>> HandIndexer::suitPermutations;
-
-void HandIndexer::Initialise() {
-  for (auto i = 0; i < 1 << (Global::SUITS - 1); i++) {
-    for (auto j = 1; j < Global::SUITS; j++) {
-      equal[i][j] = (i & 1 << (j - 1)) != 0;
-    }
-  }
-
-  for (auto i = 0; i < 1 << Global::RANKS; i++) {
-    for (auto j = 0, set = ~i & ((1 << Global::RANKS) - 1); j < Global::RANKS;
+constexpr auto NthUnset() {
+  array<array<uint8_t, RANKS>, 1 << RANKS> nthUnset{};
+  for (auto i = 0; i < 1 << RANKS; i++) {
+    for (auto j = 0, set = ~i & ((1 << RANKS) - 1); j < RANKS;
          ++j, set &= set - 1) {
-      nthUnset[i][j] = set == 0 ? 0xff : __builtin_ctzll(set);
+      nthUnset[i][j] = set == 0 ? 0xff : __builtin_ctz(set);
     }
   }
+  return nthUnset;
+}
 
-  CacheNCRCalculation();
-
-  for (auto i = 0; i < 1 << Global::RANKS; i++) {
-    for (auto set = i, j = 1; set != 0; ++j, set &= set - 1) {
-      rankSetToIndex[i] += nCrRanks[__builtin_ctzll(set)][j];
-    }
-    indexToRankSet[__builtin_popcountll((unsigned int)i)][rankSetToIndex[i]] =
-        i;
-  }
-
-  int numPermutations = 1;
-  for (auto i = 2; i <= Global::SUITS; ++i) {
-    numPermutations *= i;
-  }
-
-  suitPermutations =
-      vector<vector<int>>(numPermutations, vector<int>(Global::SUITS));
-  for (auto i = 0; i < numPermutations; ++i) {
-    for (auto j = 0, index = i, used = 0; j < Global::SUITS; ++j) {
-      int suit = index % (Global::SUITS - j);
-      index /= Global::SUITS - j;
-      int shiftedSuit = nthUnset[used][suit];
-      suitPermutations[i][j] = shiftedSuit;
-      used |= 1 << shiftedSuit;
+constexpr auto Equal() {
+  array<array<bool, SUITS>, 1 << (SUITS - 1)> equal{};
+  for (auto i = 0; i < 1 << (SUITS - 1); i++) {
+    for (auto j = 1; j < SUITS; j++) {
+      equal[i][j] = (i & 1 << (j - 1)) != 0;
     }
   }
+  return equal;
 }
 
-void HandIndexer::CacheNCRCalculation() {
+constexpr auto NCrRanks() {
+  array<array<int, RANKS + 1>, RANKS + 1> nCrRanks{};
   nCrRanks[0][0] = 1;
-  for (auto i = 1; i < Global::RANKS + 1; ++i) {
+  for (auto i = 1; i < RANKS + 1; ++i) {
     nCrRanks[i][0] = nCrRanks[i][i] = 1;
     for (auto j = 1; j < i; ++j) {
       nCrRanks[i][j] = nCrRanks[i - 1][j - 1] + nCrRanks[i - 1][j];
     }
   }
+  return nCrRanks;
+}
 
-  nCrGroups[0][0] = 1;
-  for (auto i = 1; i < MAX_GROUP_INDEX; ++i) {
-    nCrGroups[i][0] = 1;
-    if (i < Global::SUITS + 1) {
-      nCrGroups[i][i] = 1;
+constexpr auto RankSetToIndex() {
+  auto nCrRanks = NCrRanks();
+  array<int, 1 << RANKS> rankSetToIndex{};
+  for (auto i = 0; i < 1 << RANKS; i++) {
+    for (auto set = i, j = 1; set != 0; ++j, set &= set - 1) {
+      rankSetToIndex[i] += nCrRanks[__builtin_ctz(set)][j];
     }
-    for (auto j = 1; j < (i < (Global::SUITS + 1) ? i : (Global::SUITS + 1));
-         ++j) {
-      nCrGroups[i][j] = nCrGroups[i - 1][j - 1] + nCrGroups[i - 1][j];
+  }
+  return rankSetToIndex;
+}
+
+constexpr auto IndexToRankSet() {
+  auto rankSetToIndex = RankSetToIndex();
+  array<array<int, 1 << RANKS>, RANKS + 1> indexToRankSet{};
+  for (auto i = 0; i < 1 << RANKS; i++) {
+    indexToRankSet[__builtin_popcount(i)][rankSetToIndex[i]] = i;
+  }
+  return indexToRankSet;
+}
+
+constexpr auto SuitPermutations() {
+  auto nthUnset = NthUnset();
+  array<array<int, SUITS>, PERMUTATIONS> suitPermutations{};
+  for (auto i = 0; i < PERMUTATIONS; ++i) {
+    for (auto j = 0, index = i, used = 0; j < SUITS; ++j) {
+      int suit = index % (SUITS - j);
+      index /= SUITS - j;
+      int shiftedSuit = nthUnset[used][suit];
+      suitPermutations[i][j] = shiftedSuit;
+      used |= 1 << shiftedSuit;
     }
   }
+  return suitPermutations;
 }
+} // namespace
+
+constinit const array<array<uint8_t, HandIndexer::RANKS>,
+                      1 << HandIndexer::RANKS>
+    HandIndexer::nthUnset = NthUnset();
+constinit const array<array<bool, HandIndexer::SUITS>,
+                      1 << (HandIndexer::SUITS - 1)>
+    HandIndexer::equal = Equal();
+constinit const array<array<int, HandIndexer::RANKS + 1>,
+                      HandIndexer::RANKS + 1>
+    HandIndexer::nCrRanks = NCrRanks();
+constinit const array<int, 1 << HandIndexer::RANKS>
+    HandIndexer::rankSetToIndex = RankSetToIndex();
+constinit const array<array<int, 1 << HandIndexer::RANKS>,
+                      HandIndexer::RANKS + 1>
+    HandIndexer::indexToRankSet = IndexToRankSet();
+constinit const array<array<int, HandIndexer::SUITS>,
+                      HandIndexer::PERMUTATIONS>
+    HandIndexer::suitPermutations = SuitPermutations();
 
 HandIndexer::HandIndexer() {}
 
@@ -198,7 +211,7 @@ void HandIndexer::CreatePublicFlopHands() {
  * @param indices an array where the indices for every round will be saved to
  * @return hands index on the last round
  */
-long HandIndexer::IndexAllRounds(vector<int> &cards, vector<long> &indices) {
+long HandIndexer::IndexAllRounds(span<const int> cards, span<long> indices) {
   if (rounds <= 0) {
     return 0;
   }
@@ -216,38 +229,28 @@ long HandIndexer::IndexAllRounds(vector<int> &cards, vector<long> &indices) {
  * @param cards
  * @return hand's index on the last round
  */
-long HandIndexer::IndexLastRound(vector<int> &cards) {
-  // cout << "Indexing last round with cards: ";
-  // for (auto card : cards)
-  //     cout << card << " ";
-  // cout << endl;
-
-  for (auto card : cards)
-    if (card < 0)
-      throw invalid_argument("card value cannot be negative.");
-
-  vector<long> indices(rounds);
-  long res = IndexAllRounds(cards, indices);
-  // cout << "return value: " << res << endl;
-  // cout << "result indices: ";
-  // for (auto i : indices)
-  //     cout << i << " ";
-  // cout << endl;
-  return res;
+long HandIndexer::IndexLastRound(span<const int> cards) {
+  HandIndexerState state = HandIndexerState();
+  long index = 0;
+  for (auto i = 0; i < rounds; i++) {
+    index = IndexNextRound(state, cards);
+  }
+  return index;
 }
 
 /**
  * Incrementally index the next round.
  *
  * @param state
- * @param cards the cards for the next round only!
+ * @param cards the cards of all rounds, only the next round is read
  * @return hand's index on the latest round
  */
-long HandIndexer::IndexNextRound(HandIndexerState &state, vector<int> &cards) {
-  int round = state.round++;
+long HandIndexer::IndexNextRound(HandIndexerState &state,
+                                 span<const int> cards) {
+  int round = state.round;
 
-  vector<int> ranks(Global::SUITS);
-  vector<int> shiftedRanks(Global::SUITS);
+  array<int, Global::SUITS> ranks{};
+  array<int, Global::SUITS> shiftedRanks{};
 
   for (auto i = 0, j = roundStart[round]; i < cardsPerRound[round]; ++i, ++j) {
     int rank = cards[j] >> 2;
@@ -256,13 +259,29 @@ long HandIndexer::IndexNextRound(HandIndexerState &state, vector<int> &cards) {
 
     ranks[suit] |= rankBit;
     shiftedRanks[suit] |=
-        (rankBit >> __builtin_popcountll(
-                        (unsigned int)((rankBit - 1) & state.usedRanks[suit])));
+        (rankBit >> __builtin_popcount((rankBit - 1) & state.usedRanks[suit]));
   }
 
+  AdvanceState(state, cardsPerRound[round], ranks, shiftedRanks);
+  return RoundIndex(state);
+}
+
+/**
+ * Fold the cards of one round into the state.
+ *
+ * @param state
+ * @param roundCards number of cards dealt in the round
+ * @param ranks rank set of the round's cards per suit
+ * @param shiftedRanks the same ranks with the ranks used in earlier rounds
+ * removed
+ */
+void HandIndexer::AdvanceState(HandIndexerState &state, int roundCards,
+                               const array<int, Global::SUITS> &ranks,
+                               const array<int, Global::SUITS> &shiftedRanks) {
+  state.round++;
   for (auto i = 0; i < Global::SUITS; i++) {
-    int usedSize = __builtin_popcountll((unsigned int)state.usedRanks[i]);
-    int thisSize = __builtin_popcountll((unsigned int)ranks[i]);
+    int usedSize = __builtin_popcount(state.usedRanks[i]);
+    int thisSize = __builtin_popcount(ranks[i]);
 
     state.suitIndex[i] +=
         state.suitMultiplier[i] * rankSetToIndex[shiftedRanks[i]];
@@ -270,22 +289,30 @@ long HandIndexer::IndexNextRound(HandIndexerState &state, vector<int> &cards) {
     state.usedRanks[i] |= ranks[i];
   }
 
-  for (auto i = 0, remaining = cardsPerRound[round]; i < Global::SUITS - 1;
-       ++i) {
-    int thisSize = __builtin_popcountll((unsigned int)ranks[i]);
+  for (auto i = 0, remaining = roundCards; i < Global::SUITS - 1; ++i) {
+    int thisSize = __builtin_popcount(ranks[i]);
     state.permutationIndex += state.permutationMultiplier * thisSize;
     state.permutationMultiplier *= remaining + 1;
     remaining -= thisSize;
   }
+}
 
+/**
+ * Index of the hand on the last round folded into the state.
+ *
+ * @param state
+ * @return hand's index on the latest round
+ */
+long HandIndexer::RoundIndex(const HandIndexerState &state) const {
+  int round = state.round - 1;
   int configuration = permutationToConfiguration[round][state.permutationIndex];
   int piIndex = permutationToPi[round][state.permutationIndex];
   int equalIndex = configurationToEqual[round][configuration];
   long offset = configurationToOffset[round][configuration];
-  vector<int> pi = suitPermutations[piIndex];
+  auto &pi = suitPermutations[piIndex];
 
-  vector<int> suitIndex(Global::SUITS);
-  vector<int> suitMultiplier(Global::SUITS);
+  array<int, Global::SUITS> suitIndex;
+  array<int, Global::SUITS> suitMultiplier;
   for (auto i = 0; i < Global::SUITS; ++i) {
     suitIndex[i] = state.suitIndex[pi[i]];
     suitMultiplier[i] = state.suitMultiplier[pi[i]];
@@ -304,26 +331,26 @@ long HandIndexer::IndexNextRound(HandIndexerState &state, vector<int> &cards) {
           Swap(suitIndex, i + 1, i + 3);
           Swap(suitIndex, i + 1, i + 2);
           part = suitIndex[i];
-          part += nCrGroups[suitIndex[i + 1] + 1][2];
-          part += nCrGroups[suitIndex[i + 2] + 2][3];
-          part += nCrGroups[suitIndex[i + 3] + 3][4];
-          size = nCrGroups[suitMultiplier[i] + 3][4];
+          part += NCrGroups(suitIndex[i + 1] + 1, 2);
+          part += NCrGroups(suitIndex[i + 2] + 2, 3);
+          part += NCrGroups(suitIndex[i + 3] + 3, 4);
+          size = NCrGroups(suitMultiplier[i] + 3, 4);
           i += 4;
         } else {
           Swap(suitIndex, i, i + 1);
           Swap(suitIndex, i, i + 2);
           Swap(suitIndex, i + 1, i + 2);
           part = suitIndex[i];
-          part += nCrGroups[suitIndex[i + 1] + 1][2];
-          part += nCrGroups[suitIndex[i + 2] + 2][3];
-          size = nCrGroups[suitMultiplier[i] + 2][3];
+          part += NCrGroups(suitIndex[i + 1] + 1, 2);
+          part += NCrGroups(suitIndex[i + 2] + 2, 3);
+          size = NCrGroups(suitMultiplier[i] + 2, 3);
           i += 3;
         }
       } else {
         Swap(suitIndex, i, i + 1);
         part = suitIndex[i];
-        part += nCrGroups[suitIndex[i + 1] + 1][2];
-        size = nCrGroups[suitMultiplier[i] + 1][2];
+        part += NCrGroups(suitIndex[i + 1] + 1, 2);
+        size = NCrGroups(suitMultiplier[i] + 1, 2);
         i += 2;
       }
     } else {
@@ -350,6 +377,30 @@ bool HandIndexer::Unindex(int round, long index, vector<int> &cards) {
   if (round >= rounds || index >= roundSize[round])
     return false;
 
+  int configurationIdx = ConfigurationOf(round, index);
+  index -= configurationToOffset[round][configurationIdx];
+
+  array<long, SUITS> suitIndex{};
+  for (auto i = 0; i < SUITS;) {
+    int j = SuitGroupEnd(round, configurationIdx, i);
+    long groupSize = SuitGroupSize(round, configurationIdx, i, j);
+    UnrankSuitGroup(round, configurationIdx, i, j,
+                    (long)((unsigned long)index % (unsigned long)groupSize),
+                    suitIndex);
+    index = (long)((unsigned long)index / (unsigned long)groupSize);
+    i = j;
+  }
+
+  for (auto suit = 0; suit < SUITS; ++suit)
+    SuitCards(round, configurationIdx, suit, suitIndex[suit], cards);
+  // cout << "unindex canonical card output: ";
+  // for (auto card : cards)
+  //     cout << card << " ";
+  // cout << endl;
+  return true;
+}
+
+int HandIndexer::ConfigurationOf(int round, long index) const {
   int low = 0;
   int high = configurations[round];
   int configurationIdx = 0;
@@ -363,84 +414,159 @@ bool HandIndexer::Unindex(int round, long index, vector<int> &cards) {
       high = mid;
     }
   }
-  index -= configurationToOffset[round][configurationIdx];
+  return configurationIdx;
+}
 
-  vector<long> suitIndex(Global::SUITS);
-  for (auto i = 0; i < Global::SUITS;) {
-    int j = i + 1;
-    while (j < Global::SUITS && configuration[round][configurationIdx][j] ==
-                                    configuration[round][configurationIdx][i]) {
-      j++;
-    }
+int HandIndexer::SuitGroupEnd(int round, int configurationIdx,
+                              int first) const {
+  int j = first + 1;
+  while (j < SUITS && configuration[round][configurationIdx][j] ==
+                          configuration[round][configurationIdx][first]) {
+    j++;
+  }
+  return j;
+}
 
-    int suitSize = configurationToSuitSize[round][configurationIdx][i];
-    long groupSize = nCrGroups[suitSize + j - i - 1][j - i];
-    long groupIndex = (long)((unsigned long)index % (unsigned long)groupSize);
+long HandIndexer::SuitGroupSize(int round, int configurationIdx, int first,
+                                int end) const {
+  int suitSize = configurationToSuitSize[round][configurationIdx][first];
+  return NCrGroups(suitSize + end - first - 1, end - first);
+}
 
-    index = (long)((unsigned long)index / (unsigned long)groupSize);
-    for (; i < j - 1; ++i) {
-      suitIndex[i] =
-          (int)floor(exp(log(groupIndex) / (j - i) - 1 + log(j - i)) - j - i);
-      low = (int)floor(exp(log(groupIndex) / (j - i) - 1 + log(j - i)) - j - i);
-      high = (int)ceil(exp(log(groupIndex) / (j - i) + log(j - i)) - j + i + 1);
-      if ((uint)high > (uint)suitSize) {
-        high = suitSize;
-      }
-      if ((uint)high <= (uint)low) {
-        low = 0;
-      }
-      while ((uint)low < (uint)high) {
-        int mid = (int)((uint)(low + high) / 2);
-        if (nCrGroups[mid + j - i - 1][j - i] <= groupIndex) {
-          suitIndex[i] = mid;
-          low = mid + 1;
-        } else {
-          high = mid;
-        }
-      }
-      groupIndex -= nCrGroups[(suitIndex[i] + j - i - 1)][j - i];
-    }
-
-    suitIndex[i] = groupIndex;
-    ++i;
-  }
-
-  vector<int> location(roundStart);
-
-  for (auto suit = 0; suit < Global::SUITS; ++suit) {
-    int used = 0, m = 0;
-    for (auto r = 0; r < rounds; ++r) {
-      int n = configuration[round][configurationIdx][suit] >>
-                  (ROUND_SHIFT * (rounds - r - 1)) &
-              ROUND_MASK;
-      int roundSize = nCrRanks[Global::RANKS - m][n];
-      m += n;
-      int roundIdx = (int)((ulong)suitIndex[suit] % (ulong)roundSize);
-      suitIndex[suit] = (long)((ulong)suitIndex[suit] / (ulong)roundSize);
-      int shiftedCards = indexToRankSet[n][roundIdx], rankSet = 0;
-      for (auto k = 0; k < n; ++k) {
-        int shiftedCard = shiftedCards & -shiftedCards;
-        shiftedCards ^= shiftedCard;
-        int card = nthUnset[used][__builtin_ctzll(shiftedCard)];
-        rankSet |= (1 << card);
-        cards[location[r]++] = card << 2 | suit;
+void HandIndexer::UnrankSuitGroup(int round, int configurationIdx, int first,
+                                  int end, long groupIndex,
+                                  array<long, SUITS> &suitIndex) const {
+  int suitSize = configurationToSuitSize[round][configurationIdx][first];
+  int low, high;
+  int i = first, j = end;
+  for (; i < j - 1; ++i) {
+    suitIndex[i] =
+        (int)floor(exp(log(groupIndex) / (j - i) - 1 + log(j - i)) - j - i);
+    low = (int)floor(exp(log(groupIndex) / (j - i) - 1 + log(j - i)) - j - i);
+    high = (int)ceil(exp(log(groupIndex) / (j - i) + log(j - i)) - j + i + 1);
+    if ((uint)high > (uint)suitSize) {
+      high = suitSize;
+    }
+    if ((uint)high <= (uint)low) {
+      low = 0;
+    }
+    while ((uint)low < (uint)high) {
+      int mid = (int)((uint)(low + high) / 2);
+      if (NCrGroups(mid + j - i - 1, j - i) <= groupIndex) {
+        suitIndex[i] = mid;
+        low = mid + 1;
+      } else {
+        high = mid;
       }
-      used |= rankSet;
     }
+    groupIndex -= NCrGroups(suitIndex[i] + j - i - 1, j - i);
   }
-  // cout << "unindex canonical card output: ";
-  // for (auto card : cards)
-  //     cout << card << " ";
-  // cout << endl;
-  return true;
+
+  suitIndex[i] = groupIndex;
 }
 
-void HandIndexer::Swap(vector<int> &suitIndex, int u, int v) {
-  if (suitIndex[u] > suitIndex[v]) {
-    int tmp = suitIndex[u];
-    suitIndex[u] = suitIndex[v];
-    suitIndex[v] = tmp;
+void HandIndexer::SuitCards(int round, int configurationIdx, int suit,
+                            long suitIndex, span<int> cards) const {
+  auto &suitConfiguration = configuration[round][configurationIdx];
+  int used = 0, m = 0;
+  for (auto r = 0; r < rounds; ++r) {
+    int shift = ROUND_SHIFT * (rounds - r - 1);
+    // the cards of this round of the lower suits come first
+    int location = roundStart[r];
+    for (auto s = 0; s < suit; ++s)
+      location += suitConfiguration[s] >> shift & ROUND_MASK;
+
+    int n = suitConfiguration[suit] >> shift & ROUND_MASK;
+    int roundSize = nCrRanks[Global::RANKS - m][n];
+    m += n;
+    int roundIdx = (int)((ulong)suitIndex % (ulong)roundSize);
+    suitIndex = (long)((ulong)suitIndex / (ulong)roundSize);
+    int shiftedCards = indexToRankSet[n][roundIdx], rankSet = 0;
+    for (auto k = 0; k < n; ++k) {
+      int shiftedCard = shiftedCards & -shiftedCards;
+      shiftedCards ^= shiftedCard;
+      int card = nthUnset[used][__builtin_ctzll(shiftedCard)];
+      rankSet |= (1 << card);
+      cards[location++] = card << 2 | suit;
+    }
+    used |= rankSet;
+  }
+}
+
+HandEnumerator::HandEnumerator(const HandIndexer &indexer, int round,
+                               long index)
+    : indexer{&indexer}, round{round}, index{index}, configurationIdx{0},
+      groupEnd{}, groupSize{}, groupIndex{}, suitIndex{},
+      cards(indexer.roundStart[round] + indexer.cardsPerRound[round]) {
+  if (Done())
+    return;
+  configurationIdx = indexer.ConfigurationOf(round, index);
+  StartConfiguration(index -
+                     indexer.configurationToOffset[round][configurationIdx]);
+}
+
+void HandEnumerator::Next() {
+  if (++index >= indexer->roundSize[round])
+    return;
+
+  // the first group of suits changes fastest, like the lowest digit of a
+  // number, and only the groups that change are unranked again
+  for (auto i = 0; i < SUITS; i = groupEnd[i]) {
+    if (groupIndex[i] + 1 < groupSize[i]) {
+      SetGroup(i, groupIndex[i] + 1);
+      return;
+    }
+    SetGroup(i, 0);
   }
+  configurationIdx++;
+  StartConfiguration(0);
+}
+
+void HandEnumerator::StartConfiguration(long position) {
+  for (auto i = 0; i < SUITS; i = groupEnd[i]) {
+    groupEnd[i] = indexer->SuitGroupEnd(round, configurationIdx, i);
+    groupSize[i] =
+        indexer->SuitGroupSize(round, configurationIdx, i, groupEnd[i]);
+    SetGroup(i, position % groupSize[i]);
+    position /= groupSize[i];
+  }
+}
+
+void HandEnumerator::SetGroup(int first, long position) {
+  groupIndex[first] = position;
+  indexer->UnrankSuitGroup(round, configurationIdx, first, groupEnd[first],
+                           position, suitIndex);
+  for (auto suit = first; suit < groupEnd[first]; ++suit)
+    indexer->SuitCards(round, configurationIdx, suit, suitIndex[suit], cards);
+}
+
+StreetIndexer::StreetIndexer()
+    : hole{}, boardCards{0}, boardRanks{}, shiftedBoardRanks{} {}
+
+StreetIndexer::StreetIndexer(int card1, int card2)
+    : hole{}, boardCards{0}, boardRanks{}, shiftedBoardRanks{} {
+  array<int, Global::SUITS> ranks{};
+  ranks[card1 & 3] |= 1 << (card1 >> 2);
+  ranks[card2 & 3] |= 1 << (card2 >> 2);
+  // nothing was used before the hole cards, so nothing is shifted
+  HandIndexer::AdvanceState(hole, 2, ranks, ranks);
+}
+
+void StreetIndexer::Deal(int card) {
+  int suit = card & 3;
+  int rankBit = 1 << (card >> 2);
+  boardRanks[suit] |= rankBit;
+  shiftedBoardRanks[suit] |=
+      rankBit >> __builtin_popcount((rankBit - 1) & hole.usedRanks[suit]);
+  boardCards++;
+}
+
+long StreetIndexer::Index(const HandIndexer &indexer) const {
+  if (!boardCards)
+    return indexer.RoundIndex(hole);
+  HandIndexerState state = hole;
+  HandIndexer::AdvanceState(state, boardCards, boardRanks, shiftedBoardRanks);
+  return indexer.RoundIndex(state);
 }
 
 void HandIndexer::EnumerateConfigurations(bool tabulate) {
@@ -552,7 +678,7 @@ OUT:
       configurationToSuitSize[round][id][k] = size;
     }
 
-    configurationToOffset[round][id] *= nCrGroups[size + j - i - 1][j - i];
+    configurationToOffset[round][id] *= NCrGroups(size + j - i - 1, j - i);
 
     for (auto k = i + 1; k < j; ++k) {
       equal |= 1 << k;
@@ -3,7 +3,7 @@
 /// http://poker.cs.ualberta.ca/publications/AAMAS13-abstraction.pdf
 ///
 /// cluster starting hands (169) into 8 buckets using earth mover's distance
-/// (monte carlo sampling) then, for each river private state calculate winning
+/// (of their equity histograms over every board) then, for each river private state calculate winning
 /// chance against each of the 8 buckets (opponent hands) so we have 123156254
 /// river combinations (2 + 5 cards), which need to be checked against the
 /// opponent cards then we use k means with L2 distance metric to cluster all
@@ -18,119 +18,107 @@ using namespace chrono;
 using namespace indicators;
 
 namespace poker {
-vector<int> OCHSTable::preflopIndices; // has 169 elements to map each starting
-                                       // hand to a cluster
-vector<int> OCHSTable::riverIndices;   // mapping each canonical river hand (7
-                                       // cards) to a cluster
+// has 169 elements to map each starting hand to a cluster
+utils::ArtifactView<int> OCHSTable::preflopIndices;
+// mapping each canonical river hand (7 cards) to a cluster
+utils::ArtifactView<OCHSTable::RiverBucket> OCHSTable::riverIndices;
 
-vector<vector<float>> OCHSTable::histogramsPreflop;
-vector<vector<float>> OCHSTable::histogramsRiver;
+utils::Matrix<float> OCHSTable::histogramsPreflop;
 
 const string OCHSTable::filenameOppClusters = "OCHSOpponentClusters.bin";
 const string OCHSTable::filenameRiverClusters = "OCHSRiverClusters.bin";
-const string OCHSTable::filenameRiverHistograms = "OCHSRiverHistograms.bin";
-
-void OCHSTable::Init() {
-  LoadFromFile();
+// prefix of the histogram chunk files
+const string OCHSTable::filenameRiverHistograms = "OCHSRiverHistograms";
+// snapshot of the clustering in progress
+const string OCHSTable::filenameRiverKmeans = "OCHSRiverKmeans.bin";
+
+void OCHSTable::BuildPreflopClusters() {
+  CalculateOCHSOpponentClusters();
+  ClusterPreflopHands();
+}
 
-  if (riverIndices.size())
-    return;
+void OCHSTable::BuildRiverClusters() {
+  preflopIndices = utils::LoadArtifact<int>(filenameOppClusters,
+                                            Global::nofOpponentClusters);
 
-  if (!histogramsRiver.size()) {
-    if (!preflopIndices.size()) {
-      CalculateOCHSOpponentClusters();
-      ClusterPreflopHands();
-      SaveToFile();
-    }
-    GenerateRiverHistograms();
-    SaveToFile();
-  }
+  // continues with the first chunk missing on disk
+  GenerateRiverHistograms();
   ClusterRiver();
-  SaveToFile();
+}
+
+void OCHSTable::Load(bool verify) {
+  LoadFromFile(verify);
+  if (!preflopIndices.size() || !riverIndices.size())
+    throw runtime_error("OCHS tables are missing, run `abstraction build`");
 }
 
 void OCHSTable::CalculateOCHSOpponentClusters() {
   std::cout << "Calculating " << Global::nofOpponentClusters
-            << " opponent clusters for OCHS using Monte Carlo Sampling..."
+            << " opponent clusters for OCHS by enumerating every board..."
             << endl;
   chrono::steady_clock::time_point start = chrono::steady_clock::now();
 
-  histogramsPreflop =
-      vector<vector<float>>(Global::RANKS * Global::RANKS,
-                            vector<float>((Global::preflopHistogramSize)));
-  utils::parallelise(Global::RANKS * Global::RANKS, [&](int /*threadIdx*/,
-                                                        int itemIdx) {
-    auto cards = vector<int>(2);
-    Global::indexer_2.Unindex(Global::indexer_2.rounds - 1, itemIdx, cards);
-    long deadCardMask;
-    for (auto steps = 0; steps < Global::nofMCSimsPerPreflopHand; steps++) {
-      deadCardMask = (1L << cards[0]) + (1L << cards[1]);
-
-      int cardFlop1 = randint(0, Global::CARDS);
-      while (((1L << cardFlop1) & deadCardMask) != 0)
-        cardFlop1 = randint(0, Global::CARDS);
-      deadCardMask |= (1L << cardFlop1);
-
-      int cardFlop2 = randint(0, Global::CARDS);
-      while (((1L << cardFlop2) & deadCardMask) != 0)
-        cardFlop2 = randint(0, Global::CARDS);
-      deadCardMask |= (1L << cardFlop2);
-
-      int cardFlop3 = randint(0, Global::CARDS);
-      while (((1L << cardFlop3) & deadCardMask) != 0)
-        cardFlop3 = randint(0, Global::CARDS);
-      deadCardMask |= (1L << cardFlop3);
-
-      int cardTurn = randint(0, Global::CARDS);
-      while (((1L << cardTurn) & deadCardMask) != 0)
-        cardTurn = randint(0, Global::CARDS);
-      deadCardMask |= (1L << cardTurn);
-
-      int cardRiver = randint(0, Global::CARDS);
-      while (((1L << cardRiver) & deadCardMask) != 0)
-        cardRiver = randint(0, Global::CARDS);
-      deadCardMask |= (1L << cardRiver);
-
-      auto strength = vector<int>(3);
-      for (auto card1Opponent = 0; card1Opponent < 51; card1Opponent++) {
-        if (((1L << card1Opponent) & deadCardMask) != 0) {
-          continue;
-        }
-        // deadCardMask |= (1L << card1Opponent); // card2Opponent is anyway >
-        // card1Opponent
-        for (auto card2Opponent = card1Opponent + 1;
-             card2Opponent < Global::CARDS; card2Opponent++) {
-          if (((1L << card2Opponent) & deadCardMask) != 0) {
-            continue;
+  // starting hand of each pair of hole cards, by card1 * CARDS + card2
+  auto startingHands = vector<int>(Global::CARDS * Global::CARDS);
+  for (auto hand : AllOpponentHands()) {
+    auto cards = vector<int>({__builtin_ctzl(hand), 63 - __builtin_clzl(hand)});
+    startingHands[cards[0] * Global::CARDS + cards[1]] =
+        Global::indexer_2.IndexLastRound(cards);
+  }
+
+  // permuting the suits of a board and its heroes keeps their equities and
+  // starting hands, so a canonical board stands for all boards isomorphic to
+  // it and is weighted by their number
+  auto boardIndexer = HandIndexer();
+  auto cardsPerRound = vector<int>({5});
+  boardIndexer.Construct(cardsPerRound);
+
+  const int nofHands = Global::RANKS * Global::RANKS;
+  const int size = Global::preflopHistogramSize;
+  // opponents not sharing a card with a hero or the board
+  const float nofOpponents = (Global::CARDS - 7) * (Global::CARDS - 8) / 2;
+  auto counts = oneapi::tbb::parallel_reduce(
+      oneapi::tbb::blocked_range<long>(0, boardIndexer.roundSize[0]),
+      vector<double>(nofHands * size),
+      [&](const oneapi::tbb::blocked_range<long> &range,
+          vector<double> counts) {
+        auto board = HandEnumerator(boardIndexer, 0, range.begin());
+        auto equities = vector<int>();
+        for (auto i = range.begin(); i < range.end(); i++, board.Next()) {
+          ulong cards = 0ul;
+          for (auto card : board.Cards())
+            cards |= 1uL << card;
+          int weight = SuitIsomorphicBoards(cards);
+
+          auto completions = BoardState(cards).SortedCompletions();
+          BoardEquities(completions, equities);
+          for (auto j = 0UL; j < completions.size(); j++) {
+            ulong hero = completions[j].holeCards;
+            float equity = equities[j] / (2 * nofOpponents);
+            int hand = startingHands[__builtin_ctzl(hero) * Global::CARDS +
+                                     63 - __builtin_clzl(hero)];
+            counts[hand * size + min(size - 1, (int)(equity * size))] +=
+                weight;
           }
-          ulong handSevenCards = (1uL << cards[0]) + (1uL << cards[1]) +
-                                 (1uL << cardFlop1) + (1uL << cardFlop2) +
-                                 (1uL << cardFlop3) + (1uL << cardTurn) +
-                                 (1uL << cardRiver);
-          ulong handOpponentSevenCards =
-              (1uL << cardFlop1) + (1uL << cardFlop2) + (1uL << cardFlop3) +
-              (1uL << cardTurn) + (1uL << cardRiver) + (1uL << card1Opponent) +
-              (1uL << card2Opponent);
-
-          int valueSevenCards = Global::handEvaluator->Evaluate(handSevenCards);
-          int valueOpponentSevenCards =
-              Global::handEvaluator->Evaluate(handOpponentSevenCards);
-
-          // strength = histogram with column win, draw, and loss
-          int index = (valueSevenCards > valueOpponentSevenCards    ? 0
-                       : valueSevenCards == valueOpponentSevenCards ? 1
-                                                                    : 2);
-
-          strength[index] += 1;
         }
-      }
-      float equity = (strength[0] + strength[1] / 2.0f) /
-                     (strength[0] + strength[1] + strength[2]);
-      histogramsPreflop[itemIdx][(
-          min({Global::preflopHistogramSize - 1,
-               (int)(equity * (float)Global::preflopHistogramSize)}))] += 1;
-    }
-  });
+        return counts;
+      },
+      [](vector<double> a, const vector<double> &b) {
+        for (auto i = 0UL; i < a.size(); i++)
+          a[i] += b[i];
+        return a;
+      });
+
+  // starting hands have 4, 6 or 12 combinations, so the histograms are made
+  // fractions of all boards to be comparable
+  histogramsPreflop = utils::Matrix<float>(nofHands, size);
+  for (auto hand = 0; hand < nofHands; hand++) {
+    double total = 0;
+    for (auto bin = 0; bin < size; bin++)
+      total += counts[hand * size + bin];
+    for (auto bin = 0; bin < size; bin++)
+      histogramsPreflop[hand][bin] = counts[hand * size + bin] / total;
+  }
 
   chrono::steady_clock::time_point end = chrono::steady_clock::now();
   auto elapsed =
@@ -159,8 +147,13 @@ void OCHSTable::ClusterPreflopHands() {
   // k-means clustering
   Kmeans kmeans = Kmeans();
   auto emptyVector = vector<int>();
-  preflopIndices = kmeans.ClusterEMD(
-      histogramsPreflop, Global::nofOpponentClusters, 100, emptyVector);
+  utils::SaveArtifact(filenameOppClusters,
+                      kmeans.ClusterEMD(histogramsPreflop,
+                                        Global::nofOpponentClusters, 100,
+                                        emptyVector),
+                      Global::nofOpponentClusters);
+  preflopIndices = utils::LoadArtifact<int>(filenameOppClusters,
+                                            Global::nofOpponentClusters);
 
   cout << "Created the following cluster for starting hands: " << endl;
   vector<Hand> startingHands = utils::GetStartingHandChart();
@@ -183,19 +176,16 @@ void OCHSTable::ClusterRiver() {
   // k-means clustering
   chrono::steady_clock::time_point start = chrono::steady_clock::now();
 
-  Kmeans kmeans = Kmeans();
-  // TODO: vector<int> indices =
-  // FileHandler.LoadFromFileIndex("OCHSRiverClusters_temp.bin");
-
-  vector<int> indices = vector<int>();
-
-  // vector<int> indices;
-  // ifstream file("OCHSRiverClusters_temp.bin");
-  // boost::archive::binary_iarchive archive(file);
-  // archive >> indices;
-
-  riverIndices =
-      kmeans.ClusterL2(histogramsRiver, Global::nofRiverBuckets, 1, indices);
+  Kmeans kmeans = Kmeans(filenameRiverKmeans);
+  // too many rows to keep in memory for full iterations
+  BucketTable<RiverBucket>::Save(
+      BucketTable<RiverBucket>::Narrow(
+          kmeans.ClusterL2(RiverHistogramChunks(), Global::nofRiverBuckets)),
+      filenameRiverClusters, Global::nofRiverBuckets);
+  BucketTable<RiverBucket>::Load(riverIndices, filenameRiverClusters,
+                                 Global::nofRiverBuckets);
+  // the clustering snapshot is no longer needed once its table is saved
+  remove(filenameRiverKmeans.c_str());
 
   cout << "Created the following clusters for the River: " << endl;
 
@@ -230,120 +220,215 @@ void OCHSTable::GenerateRiverHistograms() {
        << endl;
   chrono::steady_clock::time_point start = chrono::steady_clock::now();
 
-  histogramsRiver =
-      vector<vector<float>>(Global::indexer_2_5.roundSize[1],
-                            vector<float>(Global::nofOpponentClusters));
-
-  atomic<long> sharedLoopCounter = 0;
-
-  indicators::show_console_cursor(false);
-  BlockProgressBar bar{
-      option::BarWidth{80},
-      option::Start{"["},
-      option::End{"]"},
-      option::ForegroundColor{Color::white},
-      option::FontStyles{std::vector<FontStyle>{FontStyle::bold}},
-      option::ShowElapsedTime{true},
-      option::ShowRemainingTime{true},
-      option::MaxProgress{Global::indexer_2_5.roundSize[1]}};
-
-  oneapi::tbb::parallel_for(0, Global::NOF_THREADS, [&](int t) {
-    long iter = 0;
-    auto [startItemIdx, endItemIdx] = utils::GetWorkItemsIndices(
-        (int)Global::indexer_2_5.roundSize[1], Global::NOF_THREADS, t);
-    for (auto i = startItemIdx; i < endItemIdx; ++i) {
-      auto cards = std::vector<int>(7);
-      Global::indexer_2_5.Unindex(Global::indexer_2_5.rounds - 1, i, cards);
-      long deadCardMask = (1L << cards[0]) + (1L << cards[1]) +
-                          (1L << cards[2]) + (1L << cards[3]) +
-                          (1L << cards[4]) + (1L << cards[5]) +
-                          (1L << cards[6]);
-
-      for (auto card1Opponent = 0; card1Opponent < 51; card1Opponent++) {
-        if (((1L << card1Opponent) & deadCardMask) != 0) {
-          continue;
-        }
-        for (auto card2Opponent = card1Opponent + 1;
-             card2Opponent < Global::CARDS; card2Opponent++) {
-          if (((1L << card2Opponent) & deadCardMask) != 0) {
-            continue;
-          }
-
-          ulong handSevenCards = (1uL << cards[0]) + (1uL << cards[1]) +
-                                 (1uL << cards[2]) + (1uL << cards[3]) +
-                                 (1uL << cards[4]) + +(1uL << cards[5]) +
-                                 (1uL << cards[6]);
-          ulong handOpponentSevenCards =
-              (1uL << card1Opponent) + (1uL << card2Opponent) +
-              (1uL << cards[2]) + (1uL << cards[3]) + (1uL << cards[4]) +
-              (1uL << cards[5]) + (1uL << cards[6]);
-
-          int valueSevenCards = Global::handEvaluator->Evaluate(handSevenCards);
-          int valueOpponentSevenCards =
-              Global::handEvaluator->Evaluate(handOpponentSevenCards);
-
-          auto preflop = std::vector<int>({card1Opponent, card2Opponent});
-          long indexPreflop = Global::indexer_2.IndexLastRound(preflop);
-          histogramsRiver[i][preflopIndices[indexPreflop]] +=
-              valueSevenCards > valueOpponentSevenCards      ? 1
-              : (valueSevenCards == valueOpponentSevenCards) ? 0.5f
-                                                             : 0.0f;
-        }
-      }
-
-      iter++;
+  // opponent cluster of each pair of hole cards, by card1 * CARDS + card2
+  auto opponentClusters = vector<int>(Global::CARDS * Global::CARDS);
+  for (auto hand : AllOpponentHands()) {
+    auto preflop = vector<int>({__builtin_ctzl(hand), 63 - __builtin_clzl(hand)});
+    opponentClusters[preflop[0] * Global::CARDS + preflop[1]] =
+        preflopIndices[Global::indexer_2.IndexLastRound(preflop)];
+  }
 
-      if (iter == 10000) {
-        sharedLoopCounter += iter;
-        bar.set_progress(sharedLoopCounter);
-        iter = 0;
-      }
-    }
+  RiverHistogramChunks().Generate([&](long begin,
+                                      utils::Matrix<float> &histograms) {
+    GenerateRiverHistograms(begin, histograms, opponentClusters);
   });
-  indicators::show_console_cursor(true);
+
   chrono::steady_clock::time_point end = chrono::steady_clock::now();
   auto elapsed =
       chrono::duration_cast<std::chrono::seconds>(end - start).count();
   cout << "Time taken to generate lookup table: " << elapsed << "[s]" << endl;
 }
 
-void OCHSTable::SaveToFile() {
-  if (preflopIndices.size() && !utils::FileExists(filenameOppClusters)) {
-    cout << "Saving table to file " << filenameOppClusters << endl;
-    ofstream file(filenameOppClusters);
-    boost::archive::binary_oarchive archive(file);
-    archive << preflopIndices;
-  }
-  if (histogramsRiver.size() && !utils::FileExists(filenameRiverHistograms)) {
-    cout << "Saving river histograms to file " << filenameRiverHistograms
-         << endl;
-    ofstream file(filenameRiverHistograms);
-    boost::archive::binary_oarchive archive(file);
-    archive << histogramsRiver;
-  }
-  if (riverIndices.size() && !utils::FileExists(filenameRiverClusters)) {
-    cout << "Saving river cluster index to file " << filenameRiverClusters
-         << endl;
-    ofstream file(filenameRiverClusters);
-    boost::archive::binary_oarchive archive(file);
-    archive << riverIndices;
+void OCHSTable::GenerateRiverHistograms(long begin,
+                                        utils::Matrix<float> &histograms,
+                                        const vector<int> &opponentClusters) {
+  struct RiverHand {
+    ulong board;
+    ulong hero;
+    long row;
+  };
+  auto hands = vector<RiverHand>(histograms.Rows());
+  oneapi::tbb::parallel_for(
+      oneapi::tbb::blocked_range<long>(0, histograms.Rows()),
+      [&](const oneapi::tbb::blocked_range<long> &range) {
+        auto river = HandEnumerator(Global::indexer_2_5,
+                                    Global::indexer_2_5.rounds - 1,
+                                    begin + range.begin());
+        for (auto row = range.begin(); row < range.end();
+             row++, river.Next()) {
+          auto &cards = river.Cards();
+          ulong board = 0ul;
+          for (auto i = 2; i < 7; i++)
+            board |= 1uL << cards[i];
+          hands[row] = {board, (1uL << cards[0]) | (1uL << cards[1]), row};
+        }
+      });
+
+  // the hands of a chunk share far fewer boards than they are, so each board
+  // is ranked once and all of its heroes are filled from that
+  oneapi::tbb::parallel_sort(hands.begin(), hands.end(),
+                             [](auto &a, auto &b) { return a.board < b.board; });
+  auto boardStarts = vector<long>();
+  for (auto i = 0UL; i < hands.size(); i++)
+    if (i == 0 || hands[i].board != hands[i - 1].board)
+      boardStarts.push_back(i);
+  boardStarts.push_back(hands.size());
+
+  auto threadHistograms = vector<vector<float>>(Global::NOF_THREADS);
+  // position of each pair of hole cards among the sorted completions
+  auto threadPositions = vector<vector<int>>(
+      Global::NOF_THREADS, vector<int>(Global::CARDS * Global::CARDS));
+  utils::parallelise(boardStarts.size() - 1, [&](int threadIdx, int board) {
+    auto completions =
+        BoardState(hands[boardStarts[board]].board).SortedCompletions();
+    auto &boardHistograms = threadHistograms[threadIdx];
+    BoardHistograms(completions, opponentClusters, boardHistograms);
+
+    auto &positions = threadPositions[threadIdx];
+    for (auto i = 0UL; i < completions.size(); i++) {
+      ulong hand = completions[i].holeCards;
+      positions[__builtin_ctzl(hand) * Global::CARDS + 63 -
+                __builtin_clzl(hand)] = i;
+    }
+    for (auto i = boardStarts[board]; i < boardStarts[board + 1]; i++) {
+      ulong hero = hands[i].hero;
+      auto histogram = boardHistograms.begin() +
+                       positions[__builtin_ctzl(hero) * Global::CARDS + 63 -
+                                 __builtin_clzl(hero)] *
+                           Global::nofOpponentClusters;
+      copy(histogram, histogram + Global::nofOpponentClusters,
+           histograms[hands[i].row]);
+    }
+  });
+}
+
+void OCHSTable::BoardHistograms(
+    const vector<BoardState::Completion> &completions,
+    const vector<int> &opponentClusters, vector<float> &histograms) {
+  const int clusters = Global::nofOpponentClusters;
+  histograms.assign(completions.size() * clusters, 0.0f);
+
+  // opponents swept so far per cluster, in total and by each card they hold.
+  // An opponent shares a card with the hero if it holds either hero card, and
+  // only the hero itself holds both.
+  array<int, clusters> swept{};
+  array<array<int, clusters>, Global::CARDS> sweptWithCard{};
+  auto disjoint = [&](int card1, int card2, int cluster) {
+    return swept[cluster] - sweptWithCard[card1][cluster] -
+           sweptWithCard[card2][cluster];
+  };
+
+  for (auto begin = 0UL, end = 0UL; begin < completions.size(); begin = end) {
+    while (end < completions.size() &&
+           completions[end].value == completions[begin].value)
+      end++;
+
+    // heroes of one value beat everything swept so far
+    for (auto i = begin; i < end; i++) {
+      ulong hero = completions[i].holeCards;
+      int card1 = __builtin_ctzl(hero), card2 = 63 - __builtin_clzl(hero);
+      for (auto cluster = 0; cluster < clusters; cluster++)
+        histograms[i * clusters + cluster] = disjoint(card1, card2, cluster);
+    }
+    for (auto i = begin; i < end; i++) {
+      ulong hero = completions[i].holeCards;
+      int card1 = __builtin_ctzl(hero), card2 = 63 - __builtin_clzl(hero);
+      int cluster = opponentClusters[card1 * Global::CARDS + card2];
+      swept[cluster]++;
+      sweptWithCard[card1][cluster]++;
+      sweptWithCard[card2][cluster]++;
+    }
+    // and tie the rest of their value, so wins + ties / 2 is the mean of both
+    for (auto i = begin; i < end; i++) {
+      ulong hero = completions[i].holeCards;
+      int card1 = __builtin_ctzl(hero), card2 = 63 - __builtin_clzl(hero);
+      int own = opponentClusters[card1 * Global::CARDS + card2];
+      for (auto cluster = 0; cluster < clusters; cluster++) {
+        // the hero was subtracted once too often
+        int notStronger = disjoint(card1, card2, cluster) + (cluster == own);
+        auto &value = histograms[i * clusters + cluster];
+        value = (value + notStronger) / 2;
+      }
+    }
   }
 }
 
-void OCHSTable::LoadFromFile() {
-  if (utils::FileExists(filenameRiverClusters)) {
-    utils::LoadFromFile(riverIndices, filenameRiverClusters);
-  } else {
-    if (utils::FileExists(filenameRiverHistograms)) {
-      cout << "Loading river histograms from file " << filenameOppClusters
-           << endl;
-      utils::LoadFromFile(histogramsRiver, filenameRiverHistograms);
+void OCHSTable::BoardEquities(const vector<BoardState::Completion> &completions,
+                              vector<int> &equities) {
+  equities.assign(completions.size(), 0);
+
+  // opponents swept so far, in total and by each card they hold, as in
+  // BoardHistograms with a single cluster
+  int swept = 0;
+  array<int, Global::CARDS> sweptWithCard{};
+  auto disjoint = [&](int card1, int card2) {
+    return swept - sweptWithCard[card1] - sweptWithCard[card2];
+  };
+
+  for (auto begin = 0UL, end = 0UL; begin < completions.size(); begin = end) {
+    while (end < completions.size() &&
+           completions[end].value == completions[begin].value)
+      end++;
+
+    for (auto i = begin; i < end; i++) {
+      ulong hero = completions[i].holeCards;
+      equities[i] = disjoint(__builtin_ctzl(hero), 63 - __builtin_clzl(hero));
+    }
+    for (auto i = begin; i < end; i++) {
+      ulong hero = completions[i].holeCards;
+      swept++;
+      sweptWithCard[__builtin_ctzl(hero)]++;
+      sweptWithCard[63 - __builtin_clzl(hero)]++;
     }
-    if (utils::FileExists(filenameOppClusters)) {
-      cout << "Loading flop opponent clusters from file " << filenameOppClusters
-           << endl;
-      utils::LoadFromFile(preflopIndices, filenameOppClusters);
+    // wins plus all not stronger, the hero was subtracted once too often
+    for (auto i = begin; i < end; i++) {
+      ulong hero = completions[i].holeCards;
+      equities[i] +=
+          disjoint(__builtin_ctzl(hero), 63 - __builtin_clzl(hero)) + 1;
     }
   }
 }
+
+int OCHSTable::SuitIsomorphicBoards(ulong board) {
+  // all permutations divided by those mapping the board to itself
+  auto suits = array<int, Global::SUITS>({0, 1, 2, 3});
+  int permutations = 0, fixing = 0;
+  do {
+    ulong image = 0ul;
+    for (ulong rest = board; rest; rest &= rest - 1) {
+      int card = __builtin_ctzl(rest), suit = card % Global::SUITS;
+      image |= 1uL << (card - suit + suits[suit]);
+    }
+    permutations++;
+    fixing += image == board;
+  } while (next_permutation(suits.begin(), suits.end()));
+  return permutations / fixing;
+}
+
+vector<ulong> OCHSTable::AllOpponentHands() {
+  auto hands = vector<ulong>();
+  for (auto card1 = 0; card1 < Global::CARDS; card1++)
+    for (auto card2 = card1 + 1; card2 < Global::CARDS; card2++)
+      hands.push_back((1uL << card1) + (1uL << card2));
+  return hands;
+}
+
+void OCHSTable::LoadFromFile(bool verify) {
+  BucketTable<RiverBucket>::Load(riverIndices, filenameRiverClusters,
+                                 Global::nofRiverBuckets, verify);
+  if (utils::FileExists(filenameOppClusters)) {
+    cout << "Loading flop opponent clusters from file " << filenameOppClusters
+         << endl;
+    preflopIndices = utils::LoadArtifact<int>(
+        filenameOppClusters, Global::nofOpponentClusters, verify);
+  }
+}
+
+utils::ChunkedMatrix OCHSTable::RiverHistogramChunks() {
+  // chunks of other opponent clusters are stale
+  return utils::ChunkedMatrix(
+      filenameRiverHistograms, Global::indexer_2_5.roundSize[1],
+      Global::nofOpponentClusters,
+      preflopIndices.Checksum());
+}
 } // namespace poker
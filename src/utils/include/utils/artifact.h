@@ -0,0 +1,155 @@
+#ifndef __ARTIFACT_H__
+#define __ARTIFACT_H__
+
+#include "utils/matrix.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+namespace utils {
+enum class DType : uint32_t { U8 = 1, U16 = 2, U32 = 3, I32 = 4, F32 = 5 };
+
+template <typename T> constexpr DType DTypeOf() {
+  if constexpr (is_same_v<T, uint8_t>)
+    return DType::U8;
+  else if constexpr (is_same_v<T, uint16_t>)
+    return DType::U16;
+  else if constexpr (is_same_v<T, uint32_t>)
+    return DType::U32;
+  else if constexpr (is_same_v<T, int32_t>)
+    return DType::I32;
+  else {
+    static_assert(is_same_v<T, float>, "no artifact dtype for this type");
+    return DType::F32;
+  }
+}
+
+struct ArtifactHeader {
+  static const size_t MAX_RANK = 4;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t dtype;
+  uint32_t rank;
+  // of the payload bytes
+  uint32_t checksum;
+  // what the payload was built with, e.g. the bucket count of a table
+  uint64_t parameters;
+  uint64_t shape[MAX_RANK];
+  uint64_t payloadOffset;
+  uint64_t payloadBytes;
+
+  vector<uint64_t> Shape() const {
+    return vector<uint64_t>(shape, shape + rank);
+  }
+};
+
+inline const uint32_t ARTIFACT_VERSION = 1;
+
+// an artifact file mapped read only, shared by the views into it
+class MappedArtifact {
+public:
+  // throws runtime_error if the file is no artifact of dtype and parameters
+  // or, if verify, its payload does not match the checksum
+  MappedArtifact(const string &filename, DType dtype, uint64_t parameters,
+                 bool verify);
+  ~MappedArtifact();
+  MappedArtifact(const MappedArtifact &) = delete;
+  MappedArtifact &operator=(const MappedArtifact &) = delete;
+
+  const ArtifactHeader &Header() const { return header; }
+  const void *Payload() const {
+    return (const char *)mapping + header.payloadOffset;
+  }
+
+private:
+  ArtifactHeader header;
+  void *mapping = nullptr;
+  size_t size = 0;
+};
+
+/// <summary>
+/// Typed read only view of the payload of a mapped artifact, copying a view
+/// shares the mapping
+/// </summary>
+template <typename T> class ArtifactView {
+public:
+  typedef T value_type;
+  typedef const T *const_iterator;
+  typedef const T *iterator;
+
+  ArtifactView() {}
+  explicit ArtifactView(shared_ptr<const MappedArtifact> artifact)
+      : artifact{artifact},
+        values{(const T *)artifact->Payload()},
+        count{artifact->Header().payloadBytes / sizeof(T)} {}
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  const T *data() const { return values; }
+  const T &operator[](size_t i) const { return values[i]; }
+  const T *begin() const { return values; }
+  const T *end() const { return values + count; }
+
+  vector<uint64_t> Shape() const {
+    return artifact ? artifact->Header().Shape() : vector<uint64_t>();
+  }
+  uint32_t Checksum() const {
+    return artifact ? artifact->Header().checksum : 0;
+  }
+
+private:
+  shared_ptr<const MappedArtifact> artifact;
+  const T *values = nullptr;
+  size_t count = 0;
+};
+
+/// <summary>
+/// Writes an artifact: a header holding the magic, version, dtype, shape,
+/// parameters and payload checksum, followed by the payload 64-byte aligned.
+/// The file is written under a temporary name and renamed, so it either is
+/// complete or does not exist. The payload is the rows given by row, rowBytes
+/// each.
+/// </summary>
+void WriteArtifact(const string &filename, DType dtype,
+                   const vector<uint64_t> &shape, uint64_t parameters,
+                   size_t nofRows, size_t rowBytes,
+                   const function<const void *(size_t)> &row);
+
+template <typename T>
+void SaveArtifact(const string &filename, const vector<T> &data,
+                  uint64_t parameters = 0) {
+  WriteArtifact(filename, DTypeOf<T>(), {data.size()}, parameters, 1,
+                data.size() * sizeof(T), [&](size_t) { return data.data(); });
+}
+
+// the padding of the rows is not written
+template <typename T>
+void SaveArtifact(const string &filename, const Matrix<T> &data,
+                  uint64_t parameters = 0) {
+  WriteArtifact(filename, DTypeOf<T>(), {data.Rows(), data.Cols()},
+                parameters, data.Rows(), data.Cols() * sizeof(T),
+                [&](size_t row) { return data[row]; });
+}
+
+// maps the file without copying the payload, the pages are shared with
+// every process mapping the same file
+template <typename T>
+ArtifactView<T> LoadArtifact(const string &filename, uint64_t parameters = 0,
+                             bool verify = true) {
+  return ArtifactView<T>(make_shared<const MappedArtifact>(
+      filename, DTypeOf<T>(), parameters, verify));
+}
+
+// false if the file is missing, truncated or no artifact of this version
+bool ReadArtifactHeader(const string &filename, ArtifactHeader &header);
+bool IsArtifact(const string &filename);
+} // namespace utils
+#endif
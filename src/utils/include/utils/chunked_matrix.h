@@ -0,0 +1,78 @@
+#ifndef __CHUNKED_MATRIX_H__
+#define __CHUNKED_MATRIX_H__
+
+#include "utils/matrix.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+using namespace std;
+
+namespace utils {
+/// <summary>
+/// Matrix of float rows kept on disk in fixed size ranges of rows, one file
+/// per chunk.
+///
+/// Every chunk file is an artifact whose parameters identify its first row and
+/// the source, see utils/artifact.h, so a file either is complete or does not
+/// exist and its rows are checked against a checksum. Generation skips
+/// the chunks already on disk, which resumes an interrupted run, and readers
+/// only need one chunk in memory at a time. Chunks generated from different
+/// inputs, as told by the source checksum, are never reused.
+///
+/// A sparse matrix keeps every chunk in compressed sparse row layout, see
+/// SparseMatrix, for rows that are mostly zero like turn histograms.
+/// </summary>
+class ChunkedMatrix {
+public:
+  // chunkRows defaults to about 64MB of dense rows per chunk
+  ChunkedMatrix(const string &prefix, long rows, int cols,
+                uint32_t source = 0, long chunkRows = 0, bool sparse = false);
+
+  long Rows() const { return rows; }
+  int Cols() const { return cols; }
+  uint32_t Source() const { return source; }
+  bool Sparse() const { return sparse; }
+  long Chunks() const { return (rows + chunkRows - 1) / chunkRows; }
+  long ChunkBegin(long chunk) const { return chunk * chunkRows; }
+  long ChunkEnd(long chunk) const { return min(rows, ChunkBegin(chunk + 1)); }
+  string Filename(long chunk) const;
+
+  // the chunk file exists with the expected shape, the checksum is only
+  // verified when it is read
+  bool IsComplete(long chunk) const;
+  bool IsComplete() const;
+
+  void Write(long chunk, const Matrix<float> &data) const;
+  // throws runtime_error if the file is damaged or of another layout, the
+  // rows of a sparse chunk are made dense
+  Matrix<float> Read(long chunk) const;
+  // only for a sparse matrix, throws runtime_error like Read
+  SparseMatrix ReadSparse(long chunk) const;
+
+  // calls generate with the first row index and the zeroed rows of every
+  // chunk missing on disk, and writes each chunk once it is filled
+  void Generate(const function<void(long, Matrix<float> &)> &generate) const;
+  // calls f with the first row index and the rows of every chunk in order
+  void ForEachChunk(const function<void(long, Matrix<float> &)> &f) const;
+  // the same for a sparse matrix, without making the rows dense
+  void ForEachSparseChunk(
+      const function<void(long, SparseMatrix &)> &f) const;
+  Matrix<float> ReadAll() const;
+  void Remove() const;
+
+private:
+  static const long CHUNK_BYTES = 1L << 26;
+
+  string prefix;
+  long rows;
+  int cols;
+  uint32_t source;
+  long chunkRows;
+  bool sparse;
+
+  uint64_t Parameters(long chunk) const;
+};
+} // namespace utils
+#endif
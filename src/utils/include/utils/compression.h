@@ -0,0 +1,58 @@
+#ifndef __COMPRESSION_H__
+#define __COMPRESSION_H__
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+namespace utils {
+// zigzag maps signed integers to unsigned so that small magnitudes stay small
+inline uint64_t ZigZagEncode(int64_t value) {
+  return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+inline int64_t ZigZagDecode(uint64_t value) {
+  return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+inline void PutVarint(string &out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back((char)(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back((char)value);
+}
+
+/**
+ * Read a LEB128 varint starting at pos and advance pos past it.
+ *
+ * @throws runtime_error if the buffer ends in the middle of the varint
+ */
+inline uint64_t GetVarint(string_view in, size_t &pos) {
+  uint64_t value = 0;
+  for (auto shift = 0; shift < 64; shift += 7) {
+    if (pos >= in.size())
+      throw runtime_error("Truncated varint");
+    uint8_t byte = (uint8_t)in[pos++];
+    value |= (uint64_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return value;
+  }
+  throw runtime_error("Malformed varint");
+}
+
+// FNV-1a, pass the previous result as hash to checksum data in pieces
+uint32_t Checksum(string_view data, uint32_t hash = 2166136261u);
+
+/*
+  LZ4 block compression, see include/lz4.
+  Blocks are self-contained so they can be decoded independently.
+*/
+string CompressBlock(string_view in);
+string DecompressBlock(string_view in, size_t rawSize);
+} // namespace utils
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef __MATRIX_H__
+#define __MATRIX_H__
+
+#include <boost/serialization/access.hpp>
+#include <boost/serialization/array_wrapper.hpp>
+#include <boost/serialization/split_member.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+namespace utils {
+// allocates on cache line boundaries so aligned rows stay aligned
+template <typename T, size_t Alignment> struct AlignedAllocator {
+  typedef T value_type;
+
+  AlignedAllocator() = default;
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U, Alignment> &) noexcept {}
+  template <typename U> struct rebind {
+    typedef AlignedAllocator<U, Alignment> other;
+  };
+
+  T *allocate(size_t n) {
+    return (T *)::operator new(n * sizeof(T), align_val_t{Alignment});
+  }
+  void deallocate(T *p, size_t) noexcept {
+    ::operator delete(p, align_val_t{Alignment});
+  }
+
+  bool operator==(const AlignedAllocator &) const noexcept { return true; }
+  bool operator!=(const AlignedAllocator &) const noexcept { return false; }
+};
+
+/// <summary>
+/// Dense row-major matrix in a single buffer, e.g. one histogram per row.
+///
+/// Rows are padded to a fixed stride of whole cache lines, so every row starts
+/// aligned and rows can be streamed and vectorised without indirection. The
+/// padding stays zero, so kernels may run over the whole stride. T may
+/// be a narrower type like uint16_t for tables that fit it. Serialization
+/// writes the dimensions and then the raw buffer.
+/// </summary>
+template <typename T> class Matrix {
+public:
+  static const size_t ALIGNMENT = 64;
+
+  Matrix() : rows{0}, cols{0}, stride{0} {}
+  Matrix(size_t rows, size_t cols)
+      : rows{rows}, cols{cols}, stride{Stride(cols)},
+        buffer(rows * Stride(cols)) {}
+
+  size_t Rows() const { return rows; }
+  size_t Cols() const { return cols; }
+  // padded row length, a multiple of whole cache lines
+  size_t Stride() const { return stride; }
+  bool Empty() const { return rows == 0; }
+
+  T *operator[](size_t row) { return buffer.data() + row * stride; }
+  const T *operator[](size_t row) const { return buffer.data() + row * stride; }
+
+  span<T> Row(size_t row) { return span<T>((*this)[row], cols); }
+  span<const T> Row(size_t row) const {
+    return span<const T>((*this)[row], cols);
+  }
+
+private:
+  friend class boost::serialization::access;
+
+  size_t rows;
+  size_t cols;
+  size_t stride;
+  vector<T, AlignedAllocator<T, ALIGNMENT>> buffer;
+
+  static size_t Stride(size_t cols) {
+    const size_t perLine = max(ALIGNMENT / sizeof(T), (size_t)1);
+    return (cols + perLine - 1) / perLine * perLine;
+  }
+
+  template <class Archive> void save(Archive &ar, const unsigned int) const {
+    ar << rows << cols;
+    ar << boost::serialization::make_array(buffer.data(), buffer.size());
+  }
+
+  template <class Archive> void load(Archive &ar, const unsigned int) {
+    ar >> rows >> cols;
+    stride = Stride(cols);
+    buffer = vector<T, AlignedAllocator<T, ALIGNMENT>>(rows * stride);
+    ar >> boost::serialization::make_array(buffer.data(), buffer.size());
+  }
+
+  BOOST_SERIALIZATION_SPLIT_MEMBER()
+};
+
+/// <summary>
+/// Rows of mostly zero floats in compressed sparse row layout, only the
+/// nonzero entries of each row are kept with their column. An entry takes 6
+/// bytes, so e.g. a turn histogram with at most 46 of its 200 bins set takes a
+/// third of its dense size or less.
+/// </summary>
+class SparseMatrix {
+public:
+  SparseMatrix() : SparseMatrix(0) {}
+  explicit SparseMatrix(size_t cols) : cols{cols}, rowStarts{0} {
+    if (cols > (size_t)numeric_limits<uint16_t>::max() + 1)
+      throw invalid_argument("Too many columns for a sparse matrix");
+  }
+  // rowStarts holds the index of the first entry of every row and the number
+  // of entries last, throws invalid_argument if the layout is inconsistent
+  SparseMatrix(size_t cols, vector<uint64_t> rowStarts,
+               vector<uint16_t> columns, vector<float> values)
+      : SparseMatrix(cols) {
+    if (rowStarts.empty() || rowStarts.front() != 0 ||
+        !is_sorted(rowStarts.begin(), rowStarts.end()) ||
+        rowStarts.back() != columns.size() ||
+        columns.size() != values.size() ||
+        any_of(columns.begin(), columns.end(),
+               [cols](uint16_t col) { return col >= cols; }))
+      throw invalid_argument("Inconsistent sparse matrix layout");
+    this->rowStarts = move(rowStarts);
+    this->columns = move(columns);
+    this->values = move(values);
+  }
+
+  size_t Rows() const { return rowStarts.size() - 1; }
+  size_t Cols() const { return cols; }
+  size_t NonZeros() const { return columns.size(); }
+
+  // appends the nonzero entries of a dense row of Cols() entries
+  void AddRow(const float *row) {
+    for (auto col = 0UL; col < cols; col++) {
+      if (row[col] != 0.0f) {
+        columns.push_back(col);
+        values.push_back(row[col]);
+      }
+    }
+    rowStarts.push_back(columns.size());
+  }
+
+  // appends a row of another sparse matrix of as many columns
+  void AddRow(const SparseMatrix &source, size_t row) {
+    auto begin = source.rowStarts[row], end = source.rowStarts[row + 1];
+    columns.insert(columns.end(), source.columns.begin() + begin,
+                   source.columns.begin() + end);
+    values.insert(values.end(), source.values.begin() + begin,
+                  source.values.begin() + end);
+    rowStarts.push_back(columns.size());
+  }
+
+  // writes the Cols() entries of row, zeros included, to destination
+  void Densify(size_t row, float *destination) const {
+    fill(destination, destination + cols, 0.0f);
+    for (auto i = rowStarts[row]; i < rowStarts[row + 1]; i++)
+      destination[columns[i]] = values[i];
+  }
+
+  const vector<uint64_t> &RowStarts() const { return rowStarts; }
+  const vector<uint16_t> &Columns() const { return columns; }
+  const vector<float> &Values() const { return values; }
+
+private:
+  size_t cols;
+  vector<uint64_t> rowStarts;
+  vector<uint16_t> columns;
+  vector<float> values;
+};
+} // namespace utils
+#endif
@@ -3,26 +3,50 @@
 
 #include <iostream>
 #include <random>
+#include <sstream>
+#include <string>
 #include <vector>
 
 using namespace std;
 
-// random integer in range [low, high)
-inline int randint(int low, int high) {
+inline std::mt19937 &randintEngine() {
   static std::random_device dev;
   static std::seed_seq seed{dev(), dev(), dev(), dev()};
   static std::mt19937 rng(seed);
+  return rng;
+}
+
+inline std::default_random_engine &randDoubleEngine() {
+  static std::default_random_engine re;
+  return re;
+}
+
+// random integer in range [low, high)
+inline int randint(int low, int high) {
   std::uniform_int_distribution<std::mt19937::result_type> distribution(
       low, high - 1);
-  return distribution(rng);
+  return distribution(randintEngine());
 }
 
 inline double randDouble() {
   static const double lower_bound = 0;
   static const double upper_bound = 1;
-  static std::default_random_engine re;
   std::uniform_real_distribution<double> unif(lower_bound, upper_bound);
-  return unif(re);
+  return unif(randDoubleEngine());
+}
+
+// stream positions of the shared engines, used to resume training. Threads
+// interleave their draws, so a multi-threaded run is not replayed exactly.
+inline string getRandomState() {
+  stringstream state;
+  state << randintEngine() << " " << randDoubleEngine();
+  return state.str();
+}
+
+inline void setRandomState(const string &serialised) {
+  stringstream state(serialised);
+  // the linear congruential engine is read without skipping whitespace
+  state >> randintEngine() >> ws >> randDoubleEngine();
 }
 
 inline int SampleDistribution(vector<float> &probabilities) {
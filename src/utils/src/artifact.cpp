@@ -0,0 +1,109 @@
+#include "utils/artifact.h"
+#include "utils/compression.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace utils {
+namespace {
+const char MAGIC[8] = {'P', 'K', 'R', 'A', 'R', 'T', 'F', '\0'};
+const size_t PAYLOAD_ALIGNMENT = 64;
+
+size_t PayloadOffset() {
+  return (sizeof(ArtifactHeader) + PAYLOAD_ALIGNMENT - 1) / PAYLOAD_ALIGNMENT *
+         PAYLOAD_ALIGNMENT;
+}
+} // namespace
+
+void WriteArtifact(const string &filename, DType dtype,
+                   const vector<uint64_t> &shape, uint64_t parameters,
+                   size_t nofRows, size_t rowBytes,
+                   const function<const void *(size_t)> &row) {
+  if (shape.size() > ArtifactHeader::MAX_RANK)
+    throw invalid_argument("Artifact rank " + to_string(shape.size()) +
+                           " is not supported");
+
+  auto header = ArtifactHeader();
+  memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = ARTIFACT_VERSION;
+  header.dtype = (uint32_t)dtype;
+  header.rank = shape.size();
+  header.parameters = parameters;
+  copy(shape.begin(), shape.end(), header.shape);
+  header.payloadOffset = PayloadOffset();
+  header.payloadBytes = nofRows * rowBytes;
+  header.checksum = Checksum("");
+  for (auto i = 0UL; i < nofRows; i++)
+    header.checksum =
+        Checksum(string_view((const char *)row(i), rowBytes), header.checksum);
+
+  // written under a temporary name so a partial artifact is never read
+  auto partial = filename + ".tmp";
+  {
+    ofstream file(partial, ios::binary);
+    file.write((const char *)&header, sizeof(header));
+    auto padding = string(header.payloadOffset - sizeof(header), '\0');
+    file.write(padding.data(), padding.size());
+    for (auto i = 0UL; i < nofRows; i++)
+      file.write((const char *)row(i), rowBytes);
+    if (!file)
+      throw runtime_error("Failed to write " + filename);
+  }
+  if (rename(partial.c_str(), filename.c_str()))
+    throw runtime_error("Failed to write " + filename);
+}
+
+bool ReadArtifactHeader(const string &filename, ArtifactHeader &header) {
+  ifstream file(filename, ios::binary);
+  if (!file.read((char *)&header, sizeof(header)) ||
+      memcmp(header.magic, MAGIC, sizeof(MAGIC)) ||
+      header.version != ARTIFACT_VERSION ||
+      header.rank > ArtifactHeader::MAX_RANK)
+    return false;
+  return filesystem::file_size(filename) ==
+         header.payloadOffset + header.payloadBytes;
+}
+
+bool IsArtifact(const string &filename) {
+  auto header = ArtifactHeader();
+  return ReadArtifactHeader(filename, header);
+}
+
+MappedArtifact::MappedArtifact(const string &filename, DType dtype,
+                               uint64_t parameters, bool verify) {
+  if (!ReadArtifactHeader(filename, header))
+    throw runtime_error(filename + " is missing or not an artifact of version " +
+                        to_string(ARTIFACT_VERSION));
+  if (header.dtype != (uint32_t)dtype)
+    throw runtime_error(filename + " holds another element type");
+  if (header.parameters != parameters)
+    throw runtime_error(filename + " was built with other parameters");
+
+  size = header.payloadOffset + header.payloadBytes;
+  auto fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw runtime_error("Failed to open " + filename);
+  mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    mapping = nullptr;
+    throw runtime_error("Failed to map " + filename);
+  }
+
+  if (verify && Checksum(string_view((const char *)Payload(),
+                                     header.payloadBytes)) != header.checksum) {
+    munmap(mapping, size);
+    throw runtime_error("Checksum mismatch in " + filename);
+  }
+}
+
+MappedArtifact::~MappedArtifact() {
+  if (mapping)
+    munmap(mapping, size);
+}
+} // namespace utils
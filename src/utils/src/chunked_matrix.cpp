@@ -0,0 +1,175 @@
+#include "utils/chunked_matrix.h"
+#include "utils/artifact.h"
+#include "utils/compression.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace utils {
+ChunkedMatrix::ChunkedMatrix(const string &prefix, long rows, int cols,
+                             uint32_t source, long chunkRows, bool sparse)
+    : prefix{prefix}, rows{rows}, cols{cols}, source{source},
+      chunkRows{chunkRows ? chunkRows
+                          : max(1L, CHUNK_BYTES / (long)(cols * sizeof(float)))},
+      sparse{sparse} {}
+
+string ChunkedMatrix::Filename(long chunk) const {
+  stringstream filename;
+  filename << prefix << ".chunk" << setw(4) << setfill('0') << chunk << ".bin";
+  return filename.str();
+}
+
+uint64_t ChunkedMatrix::Parameters(long chunk) const {
+  uint64_t begin = ChunkBegin(chunk);
+  return (uint64_t)source << 32 |
+         Checksum(string_view((const char *)&begin, sizeof(begin)));
+}
+
+// a sparse chunk is a byte artifact of shape {rows, cols, nonzeros} holding
+// the row starts, values and columns of its rows one after another
+bool ChunkedMatrix::IsComplete(long chunk) const {
+  auto header = ArtifactHeader();
+  if (!ReadArtifactHeader(Filename(chunk), header) ||
+      header.dtype != (uint32_t)(sparse ? DType::U8 : DType::F32) ||
+      header.parameters != Parameters(chunk) ||
+      header.rank != (sparse ? 3U : 2U) ||
+      header.shape[0] != (uint64_t)(ChunkEnd(chunk) - ChunkBegin(chunk)) ||
+      header.shape[1] != (uint64_t)cols)
+    return false;
+  return !sparse ||
+         header.payloadBytes == (header.shape[0] + 1) * sizeof(uint64_t) +
+                                    header.shape[2] *
+                                        (sizeof(float) + sizeof(uint16_t));
+}
+
+bool ChunkedMatrix::IsComplete() const {
+  for (auto chunk = 0L; chunk < Chunks(); chunk++)
+    if (!IsComplete(chunk))
+      return false;
+  return true;
+}
+
+void ChunkedMatrix::Write(long chunk, const Matrix<float> &data) const {
+  if ((long)data.Rows() != ChunkEnd(chunk) - ChunkBegin(chunk) ||
+      (int)data.Cols() != cols)
+    throw invalid_argument("Rows do not match chunk " + to_string(chunk) +
+                           " of " + prefix);
+  if (!sparse) {
+    SaveArtifact(Filename(chunk), data, Parameters(chunk));
+    return;
+  }
+
+  auto rows = SparseMatrix(cols);
+  for (auto row = 0UL; row < data.Rows(); row++)
+    rows.AddRow(data[row]);
+  auto payload = string();
+  auto append = [&payload](auto &values) {
+    payload.append((const char *)values.data(),
+                   values.size() * sizeof(values[0]));
+  };
+  append(rows.RowStarts());
+  append(rows.Values());
+  append(rows.Columns());
+  WriteArtifact(Filename(chunk), DType::U8,
+                {rows.Rows(), rows.Cols(), rows.NonZeros()}, Parameters(chunk),
+                1, payload.size(), [&](size_t) { return payload.data(); });
+}
+
+Matrix<float> ChunkedMatrix::Read(long chunk) const {
+  if (sparse) {
+    auto rows = ReadSparse(chunk);
+    auto data = Matrix<float>(rows.Rows(), cols);
+    for (auto row = 0UL; row < data.Rows(); row++)
+      rows.Densify(row, data[row]);
+    return data;
+  }
+
+  string filename = Filename(chunk);
+  if (!IsComplete(chunk))
+    throw runtime_error(filename + " is missing or not a chunk of " + prefix);
+
+  auto rows = LoadArtifact<float>(filename, Parameters(chunk));
+  auto data = Matrix<float>(ChunkEnd(chunk) - ChunkBegin(chunk), cols);
+  for (auto row = 0UL; row < data.Rows(); row++)
+    copy(rows.begin() + row * cols, rows.begin() + (row + 1) * cols,
+         data[row]);
+  return data;
+}
+
+SparseMatrix ChunkedMatrix::ReadSparse(long chunk) const {
+  string filename = Filename(chunk);
+  if (!sparse)
+    throw invalid_argument(prefix + " is not a sparse matrix");
+  if (!IsComplete(chunk))
+    throw runtime_error(filename + " is missing or not a chunk of " + prefix);
+
+  auto bytes = LoadArtifact<uint8_t>(filename, Parameters(chunk));
+  auto shape = bytes.Shape();
+  auto next = bytes.begin();
+  auto read = [&next]<typename T>(vector<T> &values, uint64_t size) {
+    values.resize(size);
+    memcpy(values.data(), next, size * sizeof(T));
+    next += size * sizeof(T);
+  };
+  auto rowStarts = vector<uint64_t>();
+  auto values = vector<float>();
+  auto columns = vector<uint16_t>();
+  read(rowStarts, shape[0] + 1);
+  read(values, shape[2]);
+  read(columns, shape[2]);
+  try {
+    return SparseMatrix(cols, move(rowStarts), move(columns), move(values));
+  } catch (const invalid_argument &) {
+    throw runtime_error(filename + " is not a valid sparse chunk");
+  }
+}
+
+void ChunkedMatrix::Generate(
+    const function<void(long, Matrix<float> &)> &generate) const {
+  for (auto chunk = 0L; chunk < Chunks(); chunk++) {
+    if (IsComplete(chunk))
+      continue;
+    cout << "Generating chunk " << chunk + 1 << "/" << Chunks() << " of "
+         << prefix << endl;
+    auto data = Matrix<float>(ChunkEnd(chunk) - ChunkBegin(chunk), cols);
+    generate(ChunkBegin(chunk), data);
+    Write(chunk, data);
+  }
+}
+
+void ChunkedMatrix::ForEachChunk(
+    const function<void(long, Matrix<float> &)> &f) const {
+  for (auto chunk = 0L; chunk < Chunks(); chunk++) {
+    auto data = Read(chunk);
+    f(ChunkBegin(chunk), data);
+  }
+}
+
+void ChunkedMatrix::ForEachSparseChunk(
+    const function<void(long, SparseMatrix &)> &f) const {
+  for (auto chunk = 0L; chunk < Chunks(); chunk++) {
+    auto data = ReadSparse(chunk);
+    f(ChunkBegin(chunk), data);
+  }
+}
+
+Matrix<float> ChunkedMatrix::ReadAll() const {
+  auto all = Matrix<float>(rows, cols);
+  ForEachChunk([&](long begin, Matrix<float> &data) {
+    for (auto row = 0UL; row < data.Rows(); row++)
+      copy(data[row], data[row] + cols, all[begin + row]);
+  });
+  return all;
+}
+
+void ChunkedMatrix::Remove() const {
+  for (auto chunk = 0L; chunk < Chunks(); chunk++)
+    remove(Filename(chunk).c_str());
+}
+} // namespace utils
@@ -0,0 +1,38 @@
+#include "utils/compression.h"
+
+#include "lz4/lz4.h"
+
+namespace utils {
+uint32_t Checksum(string_view data, uint32_t hash) {
+  for (auto c : data) {
+    hash ^= (uint8_t)c;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+string CompressBlock(string_view in) {
+  if (in.size() > LZ4_MAX_INPUT_SIZE)
+    throw runtime_error("Block too large to compress");
+  string out(LZ4_compressBound(in.size()), '\0');
+  auto size = LZ4_compress_default(in.data(), out.data(), in.size(),
+                                   out.size());
+  if (size <= 0)
+    throw runtime_error("Failed to compress block");
+  out.resize(size);
+  return out;
+}
+
+string DecompressBlock(string_view in, size_t rawSize) {
+  if (in.size() > LZ4_MAX_INPUT_SIZE || rawSize > LZ4_MAX_INPUT_SIZE)
+    throw runtime_error("Corrupt compressed block");
+  string out(rawSize, '\0');
+  auto size =
+      LZ4_decompress_safe(in.data(), out.data(), in.size(), out.size());
+  if (size < 0)
+    throw runtime_error("Corrupt compressed block");
+  if ((size_t)size != rawSize)
+    throw runtime_error("Compressed block size mismatch");
+  return out;
+}
+} // namespace utils
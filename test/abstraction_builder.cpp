@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <fstream>
+
+#include "tables/abstraction_builder.h"
+#include "utils/artifact.h"
+
+using namespace testing;
+
+namespace
+{
+    const string manifest = "abstraction_builder_test.txt";
+
+    // memory -> a -> b, every stage writes its parameters to its file and
+    // records its name in built
+    vector<poker::AbstractionStage> Stages(vector<string> &built,
+                                           const string &parametersA = "x=1")
+    {
+        auto stage = [&built](const string &name, const string &parameters)
+        {
+            return [&built, name, parameters]
+            {
+                built.push_back(name);
+                if (name != "memory")
+                    ofstream(name + ".abstraction_test") << parameters;
+            };
+        };
+        return {
+            {"memory", {}, "", {}, stage("memory", "")},
+            {"b", {"a"}, "y=1", {"b.abstraction_test"}, stage("b", "y=1")},
+            {"a", {"memory"}, parametersA, {"a.abstraction_test"},
+             stage("a", parametersA)},
+        };
+    }
+
+    void RemoveFiles()
+    {
+        remove(manifest.c_str());
+        remove("a.abstraction_test");
+        remove("b.abstraction_test");
+    }
+}
+
+TEST(AbstractionBuilderTest, RunsStagesInDependencyOrderOnce)
+{
+    RemoveFiles();
+    auto built = vector<string>();
+    auto builder = poker::AbstractionBuilder(Stages(built), manifest);
+    EXPECT_THAT(builder.OutdatedStages(), ElementsAre("a", "b"));
+    builder.Build();
+    EXPECT_THAT(built, ElementsAre("memory", "a", "b"));
+
+    built.clear();
+    auto rebuilder = poker::AbstractionBuilder(Stages(built), manifest);
+    EXPECT_THAT(rebuilder.OutdatedStages(), IsEmpty());
+    rebuilder.Build();
+    EXPECT_THAT(built, IsEmpty());
+
+    rebuilder.Build(true);
+    EXPECT_THAT(built, ElementsAre("memory", "a", "b"));
+    RemoveFiles();
+}
+
+TEST(AbstractionBuilderTest, ChangedParametersRebuildDependents)
+{
+    RemoveFiles();
+    auto built = vector<string>();
+    poker::AbstractionBuilder(Stages(built), manifest).Build();
+
+    built.clear();
+    auto builder = poker::AbstractionBuilder(Stages(built, "x=2"), manifest);
+    EXPECT_THAT(builder.OutdatedStages(), ElementsAre("a", "b"));
+    builder.Build();
+    EXPECT_THAT(built, ElementsAre("memory", "a", "b"));
+    RemoveFiles();
+}
+
+TEST(AbstractionBuilderTest, UnchangedOutputsKeepDependents)
+{
+    RemoveFiles();
+    auto built = vector<string>();
+    poker::AbstractionBuilder(Stages(built), manifest).Build();
+    ofstream("a.abstraction_test") << "edited";
+
+    // a is rebuilt with the same contents, so b need not be
+    built.clear();
+    poker::AbstractionBuilder(Stages(built), manifest).Build();
+    EXPECT_THAT(built, ElementsAre("memory", "a"));
+    RemoveFiles();
+}
+
+TEST(AbstractionBuilderTest, ModifiedOutputIsRebuilt)
+{
+    RemoveFiles();
+    auto built = vector<string>();
+    poker::AbstractionBuilder(Stages(built), manifest).Build();
+    ofstream("b.abstraction_test") << "edited";
+
+    built.clear();
+    auto builder = poker::AbstractionBuilder(Stages(built), manifest);
+    EXPECT_THAT(builder.OutdatedStages(), ElementsAre("b"));
+    builder.Build();
+    EXPECT_THAT(built, ElementsAre("b"));
+    RemoveFiles();
+}
+
+TEST(AbstractionBuilderTest, OnlyVerifyHashesArtifactPayloads)
+{
+    const string artifact = "c.abstraction_test";
+    remove(manifest.c_str());
+    auto stages = vector<poker::AbstractionStage>{
+        {"c", {}, "", {artifact},
+         [&] { utils::SaveArtifact(artifact, vector<int>({1, 2, 3})); }},
+    };
+    poker::AbstractionBuilder(stages, manifest).Build();
+
+    // same size and header, another payload
+    {
+        fstream file(artifact, ios::in | ios::out | ios::binary);
+        file.seekp(-1, ios::end);
+        file.put(7);
+    }
+    auto builder = poker::AbstractionBuilder(stages, manifest);
+    EXPECT_THAT(builder.OutdatedStages(false), IsEmpty());
+    EXPECT_THAT(builder.OutdatedStages(), ElementsAre("c"));
+    remove(manifest.c_str());
+    remove(artifact.c_str());
+}
+
+TEST(AbstractionBuilderTest, RejectsDependencyCycles)
+{
+    auto stages = vector<poker::AbstractionStage>{
+        {"a", {"b"}, "", {}, [] {}},
+        {"b", {"a"}, "", {}, [] {}},
+    };
+    EXPECT_THROW(poker::AbstractionBuilder(stages, manifest), invalid_argument);
+}
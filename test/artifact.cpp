@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <cstdio>
+#include <fstream>
+
+#include "utils/artifact.h"
+
+using namespace testing;
+
+TEST(ArtifactTest, ViewsMappedPayload)
+{
+    const string filename = "artifact_test.bin";
+    utils::SaveArtifact(filename, vector<uint16_t>({5, 300, 7}), 42);
+
+    auto view = utils::LoadArtifact<uint16_t>(filename, 42);
+    EXPECT_THAT(view, ElementsAre(5, 300, 7));
+    EXPECT_THAT(view.Shape(), ElementsAre(3));
+    EXPECT_EQ((uintptr_t)view.data() % 64, 0u);
+
+    // the mapping outlives the file and copies of the view share it
+    remove(filename.c_str());
+    auto copy = view;
+    EXPECT_EQ(copy.data(), view.data());
+    EXPECT_EQ(copy[1], 300);
+}
+
+TEST(ArtifactTest, MatrixRowsAreWrittenWithoutPadding)
+{
+    const string filename = "artifact_test.bin";
+    auto matrix = utils::Matrix<float>(2, 3);
+    for (auto row = 0ul; row < matrix.Rows(); row++)
+        for (auto col = 0ul; col < matrix.Cols(); col++)
+            matrix[row][col] = row * 10 + col;
+    utils::SaveArtifact(filename, matrix);
+
+    auto view = utils::LoadArtifact<float>(filename);
+    EXPECT_THAT(view, ElementsAre(0, 1, 2, 10, 11, 12));
+    EXPECT_THAT(view.Shape(), ElementsAre(2, 3));
+    remove(filename.c_str());
+}
+
+TEST(ArtifactTest, RejectsMismatchedArtifacts)
+{
+    const string filename = "artifact_test.bin";
+    utils::SaveArtifact(filename, vector<uint8_t>({1, 2, 3, 4}), 200);
+    EXPECT_TRUE(utils::IsArtifact(filename));
+    EXPECT_THROW(utils::LoadArtifact<uint16_t>(filename, 200), runtime_error);
+    EXPECT_THROW(utils::LoadArtifact<uint8_t>(filename, 100), runtime_error);
+
+    {
+        fstream file(filename, ios::binary | ios::in | ios::out);
+        file.seekp(-1, ios::end);
+        file.put('\x7f');
+    }
+    EXPECT_THROW(utils::LoadArtifact<uint8_t>(filename, 200), runtime_error);
+    EXPECT_EQ(utils::LoadArtifact<uint8_t>(filename, 200, false)[3], 0x7f);
+    remove(filename.c_str());
+
+    ofstream(filename) << "not an artifact";
+    EXPECT_FALSE(utils::IsArtifact(filename));
+    EXPECT_THROW(utils::LoadArtifact<uint8_t>(filename), runtime_error);
+    remove(filename.c_str());
+    EXPECT_FALSE(utils::IsArtifact(filename));
+}
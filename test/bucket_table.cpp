@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <cstdio>
+
+#include "tables/bucket_table.h"
+
+using namespace testing;
+using namespace poker;
+
+TEST(BucketTableTest, WidthFitsBucketCount)
+{
+    EXPECT_TRUE((is_same_v<BucketIndex<200>, uint8_t>));
+    EXPECT_TRUE((is_same_v<BucketIndex<256>, uint8_t>));
+    EXPECT_TRUE((is_same_v<BucketIndex<257>, uint16_t>));
+    EXPECT_TRUE((is_same_v<BucketIndex<70000>, uint32_t>));
+    EXPECT_EQ(BucketTable<uint8_t>::Filename("EMDFlopTable.bin"),
+              "EMDFlopTable.u8.bin");
+    EXPECT_EQ(BucketTable<uint16_t>::Filename("table"), "table.u16");
+}
+
+TEST(BucketTableTest, NarrowRejectsIndicesOutOfRange)
+{
+    EXPECT_THAT(BucketTable<uint8_t>::Narrow({0, 17, 255}),
+                ElementsAre(0, 17, 255));
+    EXPECT_THROW(BucketTable<uint8_t>::Narrow({256}), out_of_range);
+    EXPECT_THROW(BucketTable<uint16_t>::Narrow({-1}), out_of_range);
+}
+
+TEST(BucketTableTest, MigratesLegacyIntTable)
+{
+    const string filename = "bucket_table_test.bin";
+    auto legacy = vector<int>({3, 199, 0, 42});
+    utils::SaveToFile(legacy, filename);
+
+    auto table = utils::ArtifactView<uint8_t>();
+    BucketTable<uint8_t>::Load(table, filename, 200);
+    EXPECT_THAT(table, ElementsAre(3, 199, 0, 42));
+    EXPECT_TRUE(utils::IsArtifact(BucketTable<uint8_t>::Filename(filename)));
+
+    // the narrow file is preferred once it exists
+    remove(filename.c_str());
+    auto reloaded = utils::ArtifactView<uint8_t>();
+    BucketTable<uint8_t>::Load(reloaded, filename, 200);
+    EXPECT_THAT(reloaded, ElementsAreArray(table.begin(), table.end()));
+
+    // a table of another bucket count is never read
+    EXPECT_THROW(BucketTable<uint8_t>::Load(reloaded, filename, 100),
+                 runtime_error);
+    remove(BucketTable<uint8_t>::Filename(filename).c_str());
+}
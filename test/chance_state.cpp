@@ -77,3 +77,28 @@ TEST(ChanceStateTest, RiverTransition)
     EXPECT_EQ(child.community.lastPlayer, 5);
     EXPECT_EQ(child.community.playerToMove, 0);
 }
+
+TEST(ChanceStateTest, DealingCarriesStreetIndex)
+{
+    auto flopIndexer = poker::HandIndexer();
+    vector<int> flopRounds{2, 3};
+    flopIndexer.Construct(flopRounds);
+
+    auto preflop = ChanceState();
+    preflop.CreateChildren();
+    auto dealt = preflop.children[0];
+    vector<poker::Action> history;
+    auto flop = ChanceState(dealt->community, dealt->players, history);
+    flop.community.bettingRound = BettingRound::Flop;
+    flop.CreateChildren();
+    auto child = *flop.children[0];
+
+    for (auto &player : child.players)
+    {
+        auto cards = vector<int>{Card::GetIndexFromBitmask(get<0>(player.cards)),
+                                 Card::GetIndexFromBitmask(get<1>(player.cards))};
+        for (auto card : child.community.cards)
+            cards.push_back(Card::GetIndexFromBitmask(card));
+        EXPECT_EQ(player.street.Index(flopIndexer), flopIndexer.IndexLastRound(cards));
+    }
+}
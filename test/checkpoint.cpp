@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <cstdio>
+#include <filesystem>
+
+#include "algorithm/checkpoint.h"
+#include "utils/compression.h"
+
+using namespace testing;
+using namespace poker;
+
+TEST(CompressionTest, ZigZagRoundTrip)
+{
+    for (long value : {0L, 1L, -1L, 63L, -64L, 2147483647L, -2147483648L})
+    {
+        EXPECT_EQ(utils::ZigZagDecode(utils::ZigZagEncode(value)), value);
+    }
+    EXPECT_EQ(utils::ZigZagEncode(-1), 1);
+    EXPECT_EQ(utils::ZigZagEncode(1), 2);
+}
+
+TEST(CompressionTest, VarintRoundTrip)
+{
+    string buffer;
+    auto values = vector<uint64_t>({0, 127, 128, 300, 1ul << 35, ~0ul});
+    for (auto value : values)
+        utils::PutVarint(buffer, value);
+
+    size_t pos = 0;
+    for (auto value : values)
+        EXPECT_EQ(utils::GetVarint(buffer, pos), value);
+    EXPECT_EQ(pos, buffer.size());
+}
+
+TEST(CompressionTest, BlockRoundTrip)
+{
+    string repetitive;
+    for (int i = 0; i < 10000; i++)
+        repetitive += "CCR1R2F" + to_string(i % 17);
+
+    string random(5000, '\0');
+    for (auto &c : random)
+        c = (char)randint(0, 256);
+
+    for (auto &raw : {repetitive, random, string(), string("abc")})
+    {
+        auto compressed = utils::CompressBlock(raw);
+        EXPECT_EQ(utils::DecompressBlock(compressed, raw.size()), raw);
+    }
+    EXPECT_LT(utils::CompressBlock(repetitive).size(), repetitive.size() / 4);
+}
+
+TEST(CompressionTest, CorruptBlockThrows)
+{
+    string raw(1000, 'a');
+    auto compressed = utils::CompressBlock(raw);
+    EXPECT_THROW(utils::DecompressBlock(compressed, raw.size() + 1), runtime_error);
+    EXPECT_THROW(utils::DecompressBlock(compressed.substr(0, compressed.size() - 2), raw.size()),
+                 runtime_error);
+}
+
+TEST(CheckpointTest, RandomStateRestoresStream)
+{
+    auto state = getRandomState();
+    auto first = vector<int>({randint(0, 1000), randint(0, 1000), randint(0, 1000)});
+    auto firstDouble = randDouble();
+    setRandomState(state);
+    auto second = vector<int>({randint(0, 1000), randint(0, 1000), randint(0, 1000)});
+
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(randDouble(), firstDouble);
+}
+
+TEST(CheckpointTest, SaveAndLoadNodeMap)
+{
+    NodeMap nodeMap;
+    for (int i = 0; i < 5000; i++)
+    {
+        Infoset infoset(3, i % 2 ? BettingRound::Preflop : BettingRound::Flop);
+        infoset.regret = {i, -i, i % 3 ? Global::regretFloor : 12345};
+        if (infoset.actionCounter.size())
+            infoset.actionCounter = {i, 0, 7};
+        nodeMap[string("CCR1") + to_string(i) + "P" + to_string(i % 169)] = infoset;
+    }
+
+    TrainingProgress progress;
+    progress.iterations = 123450000;
+    progress.threadIterations = {20000001, 19999999};
+    progress.discountIntervalCountdown = -10000;
+    progress.randomState = getRandomState();
+    progress.abstractionFingerprint = 0xdeadbeef;
+
+    string filename = "checkpoint_test.bin";
+    Checkpoint::Save(nodeMap, progress, filename);
+    ASSERT_TRUE(Checkpoint::IsCheckpointFile(filename));
+    EXPECT_FALSE(filesystem::exists(filename + ".tmp"));
+
+    NodeMap loaded;
+    TrainingProgress loadedProgress;
+    Checkpoint::Load(loaded, loadedProgress, filename);
+    remove(filename.c_str());
+
+    EXPECT_EQ(loadedProgress.iterations, progress.iterations);
+    EXPECT_EQ(loadedProgress.threadIterations, progress.threadIterations);
+    EXPECT_EQ(loadedProgress.discountIntervalCountdown, -10000);
+    EXPECT_EQ(loadedProgress.randomState, progress.randomState);
+    EXPECT_EQ(loadedProgress.abstractionFingerprint, 0xdeadbeef);
+
+    ASSERT_EQ(loaded.size(), nodeMap.size());
+    for (auto &[key, infoset] : nodeMap)
+    {
+        ASSERT_TRUE(loaded.contains(key)) << key;
+        EXPECT_EQ(loaded[key].regret, infoset.regret);
+        EXPECT_EQ(loaded[key].actionCounter, infoset.actionCounter);
+    }
+}
+
+TEST(CheckpointTest, RejectsUnknownVersion)
+{
+    string filename = "checkpoint_old_test.bin";
+    {
+        ofstream file(filename, ios::binary);
+        uint32_t version = 2;
+        file << "MCCFRCKP";
+        file.write(reinterpret_cast<const char *>(&version), sizeof(version));
+    }
+    NodeMap nodeMap;
+    TrainingProgress progress;
+    EXPECT_THROW(Checkpoint::Load(nodeMap, progress, filename), runtime_error);
+    remove(filename.c_str());
+}
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <fstream>
+
+#include "utils/chunked_matrix.h"
+
+using namespace testing;
+
+namespace
+{
+    void FillRows(long begin, utils::Matrix<float> &rows)
+    {
+        for (auto row = 0ul; row < rows.Rows(); row++)
+            for (auto col = 0ul; col < rows.Cols(); col++)
+                rows[row][col] = (begin + row) * 10 + col;
+    }
+}
+
+TEST(ChunkedMatrixTest, ReadAllJoinsGeneratedChunks)
+{
+    auto chunks = utils::ChunkedMatrix("chunked_matrix_test", 10, 3, 7, 4);
+    ASSERT_EQ(chunks.Chunks(), 3);
+    EXPECT_EQ(chunks.ChunkEnd(2), 10);
+
+    chunks.Generate(FillRows);
+    EXPECT_TRUE(chunks.IsComplete());
+
+    auto all = chunks.ReadAll();
+    chunks.Remove();
+    ASSERT_EQ(all.Rows(), 10);
+    for (auto row = 0ul; row < all.Rows(); row++)
+        EXPECT_THAT(all.Row(row),
+                    ElementsAre(row * 10, row * 10 + 1, row * 10 + 2));
+}
+
+TEST(ChunkedMatrixTest, GenerateResumesWithMissingChunks)
+{
+    auto chunks = utils::ChunkedMatrix("chunked_matrix_test", 10, 3, 7, 4);
+    chunks.Generate(FillRows);
+    remove(chunks.Filename(1).c_str());
+
+    auto generated = vector<long>();
+    chunks.Generate([&](long begin, utils::Matrix<float> &rows)
+                    {
+                        generated.push_back(begin);
+                        FillRows(begin, rows);
+                    });
+    EXPECT_THAT(generated, ElementsAre(4));
+    EXPECT_TRUE(chunks.IsComplete());
+    chunks.Remove();
+}
+
+TEST(ChunkedMatrixTest, ChunksOfAnotherSourceAreIncomplete)
+{
+    auto chunks = utils::ChunkedMatrix("chunked_matrix_test", 10, 3, 7, 4);
+    chunks.Generate(FillRows);
+    auto other = utils::ChunkedMatrix("chunked_matrix_test", 10, 3, 8, 4);
+    EXPECT_FALSE(other.IsComplete(0));
+    EXPECT_THROW(other.Read(0), runtime_error);
+    chunks.Remove();
+}
+
+TEST(ChunkedMatrixTest, SparseChunksKeepTheirRows)
+{
+    auto chunks = utils::ChunkedMatrix("chunked_matrix_test", 10, 3, 7, 4, true);
+    chunks.Generate([](long begin, utils::Matrix<float> &rows)
+                    {
+                        for (auto row = 0ul; row < rows.Rows(); row++)
+                            rows[row][(begin + row) % 3] = begin + row + 1;
+                    });
+    EXPECT_TRUE(chunks.IsComplete());
+
+    auto sparse = chunks.ReadSparse(1);
+    EXPECT_EQ(sparse.Rows(), 4);
+    EXPECT_EQ(sparse.NonZeros(), 4);
+    auto all = chunks.ReadAll();
+    for (auto row = 0ul; row < all.Rows(); row++)
+        for (auto col = 0ul; col < all.Cols(); col++)
+            EXPECT_EQ(all[row][col], col == row % 3 ? row + 1 : 0);
+
+    // dense chunks of the same rows are not reused
+    auto dense = utils::ChunkedMatrix("chunked_matrix_test", 10, 3, 7, 4);
+    EXPECT_FALSE(dense.IsComplete(0));
+    chunks.Remove();
+}
+
+TEST(ChunkedMatrixTest, ReadRejectsDamagedChunk)
+{
+    auto chunks = utils::ChunkedMatrix("chunked_matrix_test", 10, 3, 7, 4);
+    chunks.Generate(FillRows);
+    {
+        fstream file(chunks.Filename(0), ios::binary | ios::in | ios::out);
+        file.seekp(-1, ios::end);
+        file.put('\x7f');
+    }
+    EXPECT_TRUE(chunks.IsComplete(0));
+    EXPECT_THROW(chunks.Read(0), runtime_error);
+    chunks.Remove();
+}
@@ -84,3 +84,16 @@ TEST(DeckTest, PeekCards)
     EXPECT_EQ(deck.Peek(1), 0b10);
     EXPECT_EQ(deck.Peek(7), 1 << 7);
 }
+
+TEST(DeckTest, ShuffleReplaysFromRandomState)
+{
+    auto state = getRandomState();
+    Deck first = Deck(52);
+    first.Shuffle();
+    setRandomState(state);
+    Deck second = Deck(52);
+    second.Shuffle();
+
+    for (int i = 0; i < 52; i++)
+        EXPECT_EQ(first.Peek(i), second.Peek(i));
+}
@@ -1,7 +1,9 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include "abstraction/global.h"
 #include "tables/evaluator.h"
+#include "utils/random.h"
 
 using namespace testing;
 using namespace poker;
@@ -48,3 +50,113 @@ TEST_F(EvaluatorTest, SevenCardsFullHouse)
 
     EXPECT_EQ(eval1, eval2);
 }
+
+TEST_F(EvaluatorTest, FiveCardHandsCoverAllEquivalenceClasses)
+{
+    auto seen = vector<bool>(7462);
+    for (auto a = 0; a < Global::CARDS; a++)
+        for (auto b = a + 1; b < Global::CARDS; b++)
+            for (auto c = b + 1; c < Global::CARDS; c++)
+                for (auto d = c + 1; d < Global::CARDS; d++)
+                    for (auto e = d + 1; e < Global::CARDS; e++)
+                    {
+                        auto eval = evaluator.Evaluate((1ul << a) | (1ul << b) | (1ul << c) |
+                                                       (1ul << d) | (1ul << e));
+                        ASSERT_GE(eval, 0);
+                        ASSERT_LT(eval, 7462);
+                        seen[eval] = true;
+                    }
+
+    EXPECT_EQ(count(seen.begin(), seen.end(), true), 7462);
+}
+
+TEST_F(EvaluatorTest, SevenCardsOrderedByBestFiveCardHand)
+{
+    auto bestStrength = [](ulong bitmap)
+    {
+        auto cards = Hand(bitmap).cards;
+        auto strengths = vector<HandStrength>();
+        for (auto skip1 = 0; skip1 < 7; skip1++)
+            for (auto skip2 = skip1 + 1; skip2 < 7; skip2++)
+            {
+                ulong subset = 0ul;
+                for (auto i = 0; i < 7; i++)
+                    if (i != skip1 && i != skip2)
+                        subset |= 1ul << cards[i].Index();
+                strengths.push_back(Hand(subset).GetStrength());
+            }
+        return *max_element(strengths.begin(), strengths.end());
+    };
+    auto randomHand = []()
+    {
+        ulong bitmap = 0ul;
+        while (__builtin_popcountl(bitmap) < 7)
+            bitmap |= 1ul << randint(0, Global::CARDS);
+        return bitmap;
+    };
+
+    for (auto i = 0; i < 2000; i++)
+    {
+        auto hand1 = randomHand();
+        auto hand2 = randomHand();
+        auto strength1 = bestStrength(hand1);
+        auto strength2 = bestStrength(hand2);
+        auto eval1 = evaluator.Evaluate(hand1);
+        auto eval2 = evaluator.Evaluate(hand2);
+
+        EXPECT_EQ(eval1 < eval2, strength1 < strength2);
+        EXPECT_EQ(eval1 == eval2, strength1 == strength2);
+    }
+}
+
+TEST_F(EvaluatorTest, BatchMatchesSingleEvaluation)
+{
+    for (auto boardCards : {3, 4, 5})
+        for (auto i = 0; i < 200; i++)
+        {
+            ulong board = 0ul;
+            while (__builtin_popcountl(board) < boardCards)
+                board |= 1ul << randint(0, Global::CARDS);
+
+            auto holeCards = vector<ulong>();
+            for (auto card1 = 0; card1 < Global::CARDS; card1++)
+                for (auto card2 = card1 + 1; card2 < Global::CARDS; card2++)
+                {
+                    ulong hand = (1ul << card1) | (1ul << card2);
+                    if (!(hand & board))
+                        holeCards.push_back(hand);
+                }
+            // odd sizes exercise the scalar tail after the vector loop
+            holeCards.resize(holeCards.size() - i % 4);
+
+            auto values = vector<int>(holeCards.size());
+            evaluator.EvaluateBatch(board, holeCards, values);
+            for (auto j = 0UL; j < holeCards.size(); j++)
+                ASSERT_EQ(values[j], evaluator.Evaluate(board | holeCards[j]));
+        }
+}
+
+TEST_F(EvaluatorTest, BoardStateMatchesEvaluation)
+{
+    for (auto boardCards : {3, 4, 5})
+        for (auto i = 0; i < 200; i++)
+        {
+            ulong board = 0ul;
+            while (__builtin_popcountl(board) < boardCards)
+                board |= 1ul << randint(0, Global::CARDS);
+            auto boardState = BoardState(board);
+
+            auto completions = boardState.SortedCompletions();
+            int remaining = Global::CARDS - boardCards;
+            ASSERT_EQ(completions.size(), remaining * (remaining - 1) / 2);
+            for (auto j = 0UL; j < completions.size(); j++)
+            {
+                ASSERT_EQ(completions[j].holeCards & board, 0);
+                ASSERT_EQ(completions[j].value, evaluator.Evaluate(board | completions[j].holeCards));
+                if (j)
+                {
+                    ASSERT_LE(completions[j - 1].value, completions[j].value);
+                }
+            }
+        }
+}
@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <cstdio>
+#include <fstream>
+
+#include "abstraction/global.h"
+#include "tables/flat_evaluator.h"
+#include "utils/random.h"
+
+using namespace testing;
+using namespace poker;
+
+class FlatEvaluatorTest : public Test
+{
+protected:
+    static void SetUpTestSuite()
+    {
+        flatEvaluator = new FlatEvaluator(filename);
+        flatEvaluator->Initialise();
+    }
+
+    static void TearDownTestSuite()
+    {
+        delete flatEvaluator;
+        remove(filename.c_str());
+    }
+
+    static ulong RandomHand(int cards)
+    {
+        ulong bitmap = 0ul;
+        while (__builtin_popcountl(bitmap) < cards)
+            bitmap |= 1ul << randint(0, Global::CARDS);
+        return bitmap;
+    }
+
+    inline static const string filename = "flat_evaluator_test.bin";
+    inline static FlatEvaluator *flatEvaluator = nullptr;
+    inline static poker::Evaluator evaluator = poker::Evaluator();
+};
+
+TEST_F(FlatEvaluatorTest, ColexIndexCoversAllHands)
+{
+    EXPECT_EQ(FlatEvaluator::ColexIndex(0b1111111), 0);
+    EXPECT_EQ(FlatEvaluator::ColexIndex(0b10111111), 1);
+    EXPECT_EQ(FlatEvaluator::ColexIndex(0b1111111ul << 45), 133784559);
+}
+
+TEST_F(FlatEvaluatorTest, ColexBitmapInvertsIndex)
+{
+    for (auto i = 0; i < 10000; i++)
+    {
+        auto hand = RandomHand(7);
+        EXPECT_EQ(FlatEvaluator::ColexBitmap(FlatEvaluator::ColexIndex(hand)), hand);
+    }
+    EXPECT_EQ(FlatEvaluator::ColexBitmap(133784559), 0b1111111ul << 45);
+}
+
+TEST_F(FlatEvaluatorTest, SevenCardsMatchEvaluator)
+{
+    for (auto i = 0; i < 100000; i++)
+    {
+        auto hand = RandomHand(7);
+        ASSERT_EQ(flatEvaluator->Evaluate(hand), evaluator.Evaluate(hand));
+    }
+}
+
+TEST_F(FlatEvaluatorTest, OtherHandSizesFallBack)
+{
+    for (auto cards : {5, 6})
+    {
+        auto hand = RandomHand(cards);
+        EXPECT_EQ(flatEvaluator->Evaluate(hand), evaluator.Evaluate(hand));
+    }
+}
+
+TEST_F(FlatEvaluatorTest, BatchMatchesEvaluator)
+{
+    for (auto boardCards : {4, 5})
+    {
+        auto board = RandomHand(boardCards);
+        auto holeCards = vector<ulong>();
+        for (auto i = 0; i < 100; i++)
+        {
+            auto hand = RandomHand(2);
+            if (!(hand & board))
+                holeCards.push_back(hand);
+        }
+
+        auto values = vector<int>(holeCards.size());
+        flatEvaluator->EvaluateBatch(board, holeCards, values);
+        for (auto i = 0UL; i < holeCards.size(); i++)
+            EXPECT_EQ(values[i], evaluator.Evaluate(board | holeCards[i]));
+    }
+}
+
+TEST_F(FlatEvaluatorTest, RejectsForeignFile)
+{
+    string foreign = "flat_evaluator_foreign.bin";
+    ofstream(foreign) << "not a table";
+    FlatEvaluator broken(foreign);
+
+    EXPECT_THROW(broken.Initialise(), runtime_error);
+    remove(foreign.c_str());
+}
@@ -12,7 +12,6 @@ class HandIndexerTest : public Test
 protected:
     static void SetUpTestSuite()
     {
-        handIndexer.Initialise();
         vector<int> cardsPerRound{2};
         handIndexer.Construct(cardsPerRound);
     }
@@ -57,3 +56,105 @@ TEST_F(HandIndexerTest, IsomorphicHandsHaveSameIndex)
         }
     }
 }
+
+TEST_F(HandIndexerTest, FixedArrayInputMatchesVector)
+{
+    auto flopIndexer = poker::HandIndexer();
+    vector<int> cardsPerRound{2, 3};
+    flopIndexer.Construct(cardsPerRound);
+
+    for (int i = 0; i < 1000; i++)
+    {
+        auto cards = vector<int>(5);
+        ASSERT_TRUE(flopIndexer.Unindex(1, i * 1277, cards));
+        array<int, 5> fixed;
+        copy(cards.begin(), cards.end(), fixed.begin());
+
+        auto indices = array<long, 2>();
+        EXPECT_EQ(flopIndexer.IndexLastRound(fixed), i * 1277);
+        EXPECT_EQ(flopIndexer.IndexAllRounds(cards, indices), i * 1277);
+        EXPECT_EQ(indices[0], handIndexer.IndexLastRound(span<const int>(fixed.data(), 2)));
+    }
+}
+
+TEST_F(HandIndexerTest, StreetIndexerMatchesIndexLastRound)
+{
+    auto preflopIndexer = poker::HandIndexer();
+    auto flopIndexer = poker::HandIndexer();
+    auto turnIndexer = poker::HandIndexer();
+    vector<int> preflopRounds{2};
+    vector<int> flopRounds{2, 3};
+    vector<int> turnRounds{2, 4};
+    preflopIndexer.Construct(preflopRounds);
+    flopIndexer.Construct(flopRounds);
+    turnIndexer.Construct(turnRounds);
+
+    mt19937 rng(7);
+    for (int i = 0; i < 2000; i++)
+    {
+        auto deck = vector<int>(Global::CARDS);
+        iota(deck.begin(), deck.end(), 0);
+        shuffle(deck.begin(), deck.end(), rng);
+
+        auto street = StreetIndexer(deck[0], deck[1]);
+        EXPECT_EQ(street.Index(preflopIndexer), preflopIndexer.IndexLastRound(span<const int>(deck.data(), 2)));
+        for (int j = 2; j < 5; j++)
+            street.Deal(deck[j]);
+        EXPECT_EQ(street.Index(flopIndexer), flopIndexer.IndexLastRound(span<const int>(deck.data(), 5)));
+
+        street.Deal(deck[5]);
+        EXPECT_EQ(street.Index(turnIndexer), turnIndexer.IndexLastRound(span<const int>(deck.data(), 6)));
+    }
+}
+
+TEST(HandIndexerSizeTest, StandardIndexersHaveKnownSizes)
+{
+    auto cardsPerRound = vector<vector<int>>({{2}, {2, 3}, {2, 4}, {2, 5}});
+    auto sizes = vector<long>({169, 1286792, 13960050, 123156254});
+    for (auto i = 0ul; i < sizes.size(); i++)
+    {
+        auto indexer = poker::HandIndexer();
+        indexer.Construct(cardsPerRound[i]);
+        EXPECT_EQ(indexer.roundSize[indexer.rounds - 1], sizes[i]);
+    }
+}
+
+TEST(HandEnumeratorTest, WalksHandsInIndexOrder)
+{
+    auto flopIndexer = poker::HandIndexer();
+    auto flopRounds = vector<int>({2, 3});
+    flopIndexer.Construct(flopRounds);
+
+    for (auto round = 0; round < flopIndexer.rounds; round++)
+    {
+        auto cards = vector<int>(round ? 5 : 2);
+        auto hands = poker::HandEnumerator(flopIndexer, round);
+        for (auto index = 0L; index < flopIndexer.roundSize[round]; index++, hands.Next())
+        {
+            ASSERT_FALSE(hands.Done());
+            ASSERT_EQ(hands.Index(), index);
+            flopIndexer.Unindex(round, index, cards);
+            ASSERT_EQ(hands.Cards(), cards) << "round " << round << " index " << index;
+        }
+        EXPECT_TRUE(hands.Done());
+    }
+}
+
+TEST(HandEnumeratorTest, StartsAtAnyIndex)
+{
+    auto riverIndexer = poker::HandIndexer();
+    auto riverRounds = vector<int>({2, 5});
+    riverIndexer.Construct(riverRounds);
+
+    auto cards = vector<int>(7);
+    for (auto start : {0L, 1234567L, riverIndexer.roundSize[1] - 50000})
+    {
+        auto hands = poker::HandEnumerator(riverIndexer, 1, start);
+        for (auto index = start; index < start + 50000; index++, hands.Next())
+        {
+            riverIndexer.Unindex(1, index, cards);
+            ASSERT_EQ(hands.Cards(), cards) << "index " << index;
+            ASSERT_EQ(riverIndexer.IndexLastRound(hands.Cards()), index);
+        }
+    }
+}
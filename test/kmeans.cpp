@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "algorithm/kmeans.h"
+
+#include <set>
+
+using namespace testing;
+
+namespace
+{
+// small enough batches for the few hundred rows of these tests
+poker::MiniBatchOptions SmallMiniBatchOptions(int maxIterations)
+{
+    auto options = poker::MiniBatchOptions();
+    options.batchSize = 32;
+    options.sampleSize = 200;
+    options.holdOutSize = 50;
+    options.evaluationInterval = 5;
+    options.maxIterations = maxIterations;
+    return options;
+}
+
+// rows cycle through the groups, so every row must share the cluster of its
+// group's first row and the first rows must all differ
+void ExpectGroupsInTurn(const vector<int> &clusters, int nofRows, int nofGroups)
+{
+    ASSERT_EQ(clusters.size(), nofRows);
+    EXPECT_EQ(set<int>(clusters.begin(), clusters.begin() + nofGroups).size(), nofGroups);
+    for (auto row = nofGroups; row < nofRows; row++)
+        EXPECT_EQ(clusters[row], clusters[row % nofGroups]);
+}
+} // namespace
+
+TEST(KmeansTest, MiniBatchSeparatesDistantGroups)
+{
+    // rows of 3 groups in turn, each row close to 100 * group in every column
+    const int nofGroups = 3;
+    auto chunks = utils::ChunkedMatrix("kmeans_test", 300, 4, 0, 64);
+    chunks.Generate([](long begin, utils::Matrix<float> &rows)
+                    {
+                        for (auto row = 0ul; row < rows.Rows(); row++)
+                            for (auto col = 0ul; col < rows.Cols(); col++)
+                                rows[row][col] = 100.0f * ((begin + row) % nofGroups) +
+                                                 (begin + row + col) % 5;
+                    });
+
+    auto clusters = poker::Kmeans().ClusterL2(chunks, nofGroups, SmallMiniBatchOptions(100));
+    chunks.Remove();
+
+    ExpectGroupsInTurn(clusters, 300, nofGroups);
+}
+
+TEST(KmeansTest, SparseChunksSeparateHistogramGroups)
+{
+    // histograms of 3 groups in turn, each with 10 draws in its own 10 of the
+    // 60 bins, so most entries are zero
+    const int nofGroups = 3;
+    auto chunks = utils::ChunkedMatrix("kmeans_test", 300, 60, 0, 64, true);
+    chunks.Generate([](long begin, utils::Matrix<float> &rows)
+                    {
+                        for (auto row = 0ul; row < rows.Rows(); row++)
+                            for (auto draw = 0; draw < 10; draw++)
+                                rows[row][20 * ((begin + row) % nofGroups) +
+                                          (begin + row + draw * draw) % 10]++;
+                    });
+
+    auto clusters = poker::Kmeans().ClusterEMD(chunks, nofGroups, SmallMiniBatchOptions(100));
+    chunks.Remove();
+
+    ExpectGroupsInTurn(clusters, 300, nofGroups);
+}
+
+TEST(KmeansTest, BoundsKeepEveryElementAtItsNearestCenter)
+{
+    // at convergence every element is nearest to the mean of its cluster,
+    // which fails if a bound skipped a center that had become nearer
+    const int k = 8;
+    auto data = utils::Matrix<float>(500, 4);
+    for (auto row = 0ul; row < data.Rows(); row++)
+        for (auto col = 0ul; col < data.Cols(); col++)
+            data[row][col] = randDouble();
+    auto initial = vector<int>();
+    auto clusters = poker::Kmeans().ClusterL2(data, k, 1, initial);
+    // resuming from a converged clustering keeps it
+    EXPECT_EQ(poker::Kmeans().ClusterL2(data, k, 1, clusters), clusters);
+
+    auto centers = vector<vector<double>>(k, vector<double>(data.Cols()));
+    auto sizes = vector<int>(k);
+    for (auto row = 0ul; row < data.Rows(); row++)
+    {
+        sizes[clusters[row]]++;
+        for (auto col = 0ul; col < data.Cols(); col++)
+            centers[clusters[row]][col] += data[row][col];
+    }
+    for (auto c = 0; c < k; c++)
+        for (auto &value : centers[c])
+            value /= max(sizes[c], 1);
+
+    auto distance = [&](int row, int c)
+    {
+        double sum = 0;
+        for (auto col = 0ul; col < data.Cols(); col++)
+            sum += pow(data[row][col] - centers[c][col], 2);
+        return sqrt(sum);
+    };
+    for (auto row = 0ul; row < data.Rows(); row++)
+    {
+        for (auto c = 0; c < k; c++)
+        {
+            if (sizes[c])
+            {
+                EXPECT_LE(distance(row, clusters[row]), distance(row, c) + 1e-4);
+            }
+        }
+    }
+}
+
+TEST(KmeansTest, KernelsMatchScalarDistances)
+{
+    // 50 columns, so the kernels also run over the zero padding of the rows
+    auto data = utils::Matrix<float>(2, 50);
+    for (auto row = 0ul; row < data.Rows(); row++)
+        for (auto col = 0ul; col < data.Cols(); col++)
+            data[row][col] = randDouble();
+
+    float emd = 0, cumulative = 0, l2 = 0;
+    for (auto col = 0ul; col < data.Cols(); col++)
+    {
+        cumulative += data[0][col] - data[1][col];
+        emd += abs(cumulative);
+        l2 += pow(data[0][col] - data[1][col], 2);
+    }
+    EXPECT_NEAR(poker::L2Distance::Distance(data[0], data[1], data.Stride()), sqrt(l2), 1e-4);
+
+    poker::EMDDistance::Prepare(data);
+    EXPECT_NEAR(poker::EMDDistance::Distance(data[0], data[1], data.Stride()), emd, 1e-4);
+}
+
+TEST(KmeansTest, ResumesFromCheckpointOfSameData)
+{
+    const string filename = "kmeans_test_checkpoint.bin";
+    auto data = utils::Matrix<float>(200, 3);
+    for (auto row = 0ul; row < data.Rows(); row++)
+        for (auto col = 0ul; col < data.Cols(); col++)
+            data[row][col] = randDouble();
+    auto initial = vector<int>();
+    auto clusters = poker::Kmeans(filename).ClusterL2(data, 4, 2, initial);
+
+    // every run is done, so the snapshot holds the result
+    auto checkpoint = poker::KmeansCheckpoint();
+    utils::LoadFromFile(checkpoint, filename);
+    EXPECT_EQ(checkpoint.run, 2);
+    EXPECT_EQ(checkpoint.recordAssignments, clusters);
+    EXPECT_EQ(poker::Kmeans(filename).ClusterL2(data, 4, 2, initial), clusters);
+
+    // a snapshot of other data is not used
+    data[0][0] += 1.0f;
+    poker::Kmeans(filename).ClusterL2(data, 4, 1, initial);
+    utils::LoadFromFile(checkpoint, filename);
+    EXPECT_EQ(checkpoint.run, 1);
+    remove(filename.c_str());
+}
+
+TEST(KmeansTest, MiniBatchResumesWithTrainedCenters)
+{
+    const string filename = "kmeans_test_checkpoint.bin";
+    auto chunks = utils::ChunkedMatrix("kmeans_test", 300, 4, 0, 64);
+    chunks.Generate([](long /*begin*/, utils::Matrix<float> &rows)
+                    {
+                        for (auto row = 0ul; row < rows.Rows(); row++)
+                            for (auto col = 0ul; col < rows.Cols(); col++)
+                                rows[row][col] = randDouble();
+                    });
+    auto options = SmallMiniBatchOptions(50);
+    auto clusters = poker::Kmeans(filename).ClusterEMD(chunks, 5, options);
+
+    auto checkpoint = poker::KmeansCheckpoint();
+    utils::LoadFromFile(checkpoint, filename);
+    EXPECT_TRUE(checkpoint.trained);
+    EXPECT_EQ(checkpoint.centers.Rows(), 5);
+    EXPECT_EQ(poker::Kmeans(filename).ClusterEMD(chunks, 5, options), clusters);
+    chunks.Remove();
+    remove(filename.c_str());
+}
@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <cstdio>
+
+#include "utils/matrix.h"
+#include "utils/utils.h"
+
+using namespace testing;
+
+TEST(MatrixTest, RowsAreZeroedAndAligned)
+{
+    auto matrix = utils::Matrix<float>(5, 50);
+    EXPECT_EQ(matrix.Rows(), 5);
+    EXPECT_EQ(matrix.Cols(), 50);
+    for (auto row = 0ul; row < matrix.Rows(); row++)
+    {
+        EXPECT_EQ((uintptr_t)matrix[row] % utils::Matrix<float>::ALIGNMENT, 0);
+        EXPECT_THAT(matrix.Row(row), Each(0.0f));
+    }
+    EXPECT_TRUE(utils::Matrix<float>().Empty());
+}
+
+TEST(MatrixTest, SerializesRawBuffer)
+{
+    const string filename = "matrix_test.bin";
+    auto matrix = utils::Matrix<uint16_t>(3, 7);
+    for (auto row = 0ul; row < matrix.Rows(); row++)
+        for (auto col = 0ul; col < matrix.Cols(); col++)
+            matrix[row][col] = row * 100 + col;
+    utils::SaveToFile(matrix, filename);
+
+    auto loaded = utils::Matrix<uint16_t>();
+    utils::LoadFromFile(loaded, filename);
+    remove(filename.c_str());
+
+    ASSERT_EQ(loaded.Rows(), matrix.Rows());
+    ASSERT_EQ(loaded.Cols(), matrix.Cols());
+    for (auto row = 0ul; row < matrix.Rows(); row++)
+        EXPECT_THAT(loaded.Row(row), ElementsAreArray(matrix.Row(row)));
+}
+
+TEST(MatrixTest, SparseRowsDensifyToTheirEntries)
+{
+    auto sparse = utils::SparseMatrix(5);
+    auto rows = utils::Matrix<float>(3, 5);
+    rows[0][1] = 2.0f;
+    rows[0][4] = 0.5f;
+    rows[2][0] = 7.0f;
+    for (auto row = 0ul; row < rows.Rows(); row++)
+        sparse.AddRow(rows[row]);
+    EXPECT_EQ(sparse.Rows(), 3);
+    EXPECT_EQ(sparse.NonZeros(), 3);
+
+    auto dense = vector<float>(5, -1.0f);
+    for (auto row = 0ul; row < rows.Rows(); row++)
+    {
+        sparse.Densify(row, dense.data());
+        EXPECT_THAT(dense, ElementsAreArray(rows.Row(row)));
+    }
+}
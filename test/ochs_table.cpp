@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "abstraction/global.h"
+#include "tables/ochs_table.h"
+#include "utils/random.h"
+
+using namespace testing;
+using namespace poker;
+
+TEST(OCHSTableTest, BoardHistogramsMatchPairwiseComparison)
+{
+    auto opponentClusters = vector<int>(Global::CARDS * Global::CARDS);
+    for (auto i = 0ul; i < opponentClusters.size(); i++)
+        opponentClusters[i] = randint(0, Global::nofOpponentClusters);
+
+    // random boards, plus a straight flush board and a board that ties everyone
+    auto boards = vector<ulong>({0x11111ul, 0x1f00000000000ul});
+    while (boards.size() < 20)
+    {
+        ulong board = 0ul;
+        while (__builtin_popcountl(board) < 5)
+            board |= 1ul << randint(0, Global::CARDS);
+        boards.push_back(board);
+    }
+
+    auto histograms = vector<float>();
+    for (auto board : boards)
+    {
+        auto completions = BoardState(board).SortedCompletions();
+        OCHSTable::BoardHistograms(completions, opponentClusters, histograms);
+        ASSERT_EQ(histograms.size(),
+                  completions.size() * Global::nofOpponentClusters);
+
+        for (auto i = 0ul; i < completions.size(); i++)
+        {
+            auto expected = vector<float>(Global::nofOpponentClusters);
+            for (auto &opponent : completions)
+            {
+                ulong hand = opponent.holeCards;
+                if (hand & completions[i].holeCards)
+                    continue;
+                int cluster = opponentClusters[__builtin_ctzl(hand) * Global::CARDS +
+                                               63 - __builtin_clzl(hand)];
+                if (opponent.value < completions[i].value)
+                    expected[cluster] += 1;
+                else if (opponent.value == completions[i].value)
+                    expected[cluster] += 0.5f;
+            }
+            auto actual = vector<float>(
+                histograms.begin() + i * Global::nofOpponentClusters,
+                histograms.begin() + (i + 1) * Global::nofOpponentClusters);
+            ASSERT_EQ(actual, expected) << "board " << board << " hero "
+                                        << completions[i].holeCards;
+        }
+    }
+}
+
+TEST(OCHSTableTest, BoardEquitiesMatchPairwiseComparison)
+{
+    auto boards = vector<ulong>({0x11111ul, 0x1f00000000000ul});
+    while (boards.size() < 20)
+    {
+        ulong board = 0ul;
+        while (__builtin_popcountl(board) < 5)
+            board |= 1ul << randint(0, Global::CARDS);
+        boards.push_back(board);
+    }
+
+    auto equities = vector<int>();
+    for (auto board : boards)
+    {
+        auto completions = BoardState(board).SortedCompletions();
+        OCHSTable::BoardEquities(completions, equities);
+        ASSERT_EQ(equities.size(), completions.size());
+
+        for (auto i = 0ul; i < completions.size(); i++)
+        {
+            int expected = 0;
+            for (auto &opponent : completions)
+            {
+                if (opponent.holeCards & completions[i].holeCards)
+                    continue;
+                if (opponent.value < completions[i].value)
+                    expected += 2;
+                else if (opponent.value == completions[i].value)
+                    expected += 1;
+            }
+            ASSERT_EQ(equities[i], expected) << "board " << board << " hero "
+                                             << completions[i].holeCards;
+        }
+    }
+}
+
+TEST(OCHSTableTest, SuitIsomorphicBoardsCoverEveryBoard)
+{
+    // a flush board is fixed by permuting the three other suits, a board whose
+    // suits all hold different ranks only by the identity
+    EXPECT_EQ(OCHSTable::SuitIsomorphicBoards(0x11111ul), 4);
+    EXPECT_EQ(OCHSTable::SuitIsomorphicBoards(0x18421ul), 24);
+
+    auto boardIndexer = poker::HandIndexer();
+    auto cardsPerRound = vector<int>({5});
+    boardIndexer.Construct(cardsPerRound);
+    long boards = 0;
+    for (auto board = poker::HandEnumerator(boardIndexer, 0); !board.Done();
+         board.Next())
+    {
+        ulong cards = 0ul;
+        for (auto card : board.Cards())
+            cards |= 1ul << card;
+        boards += OCHSTable::SuitIsomorphicBoards(cards);
+    }
+    EXPECT_EQ(boards, 2598960);
+}
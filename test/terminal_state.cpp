@@ -18,6 +18,12 @@ class MockEvaluator : public poker::Evaluator
         {
             return (int) cards;
         }
+
+        void EvaluateBatch(ulong board, span<const ulong> holeCards, span<int> values) override
+        {
+            for (auto i = 0UL; i < holeCards.size(); i++)
+                values[i] = Evaluate(board | holeCards[i]);
+        }
 };
 
 